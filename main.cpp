@@ -3,11 +3,14 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <thread>
+#include <atomic>
 #include <windows.h>
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #include "color.h"
 #include "env.h"
+#include "fastmath.h"
 #include "objects/objs.h"
 #include "objects/world.h"
 #include "objects/sphere.h"
@@ -19,6 +22,8 @@
 #include "material/dielectric.h"
 #include "material/bulb.h"
 #include "texture/texture.h"
+#include "scene/scene.h"
+#include "render/distributed.h"
 
 // Libraries
 #define STB_IMAGE_IMPLEMENTATION
@@ -39,26 +44,6 @@ inline void flatten_world(world& dest, const world& src) {
     }
 }
 
-inline shared_ptr<world> box(const vec3& a, const vec3& b, shared_ptr<material> mat) {
-    // Returns the 3D box containing the two opposite vertices a & b.
-    auto sides = make_shared<world>();
-    auto min = vec3(std::fmin(a.x(),b.x()), std::fmin(a.y(),b.y()), std::fmin(a.z(),b.z()));
-    auto max = vec3(std::fmax(a.x(),b.x()), std::fmax(a.y(),b.y()), std::fmax(a.z(),b.z()));
-
-    auto dx = vec3(max.x() - min.x(), 0, 0);
-    auto dy = vec3(0, max.y() - min.y(), 0);
-    auto dz = vec3(0, 0, max.z() - min.z());
-
-    sides->insert(make_shared<Quad>(vec3(min.x(), min.y(), max.z()),  dx,  dy, mat));       // front
-    sides->insert(make_shared<Quad>(vec3(max.x(), min.y(), max.z()), -1 * dz,  dy, mat));   // right
-    sides->insert(make_shared<Quad>(vec3(max.x(), min.y(), min.z()), -1 * dx,  dy, mat));   // back
-    sides->insert(make_shared<Quad>(vec3(min.x(), min.y(), min.z()),  dz,  dy, mat));       // left
-    sides->insert(make_shared<Quad>(vec3(min.x(), max.y(), max.z()),  dx, -1 * dz, mat));   // top
-    sides->insert(make_shared<Quad>(vec3(min.x(), min.y(), min.z()),  dx,  dz, mat));       // bottom
-
-    return sides;
-}
-
 // Forward declarations
 bool CreateDeviceD3D(HWND hWnd);
 void CleanupDeviceD3D();
@@ -71,6 +56,37 @@ static IDXGISwapChain* g_pSwapChain = nullptr;
 static ID3D11RenderTargetView* g_mainRenderTargetView = nullptr;
 
 int main(int argc, char** argv) {
+    // Headless modes for distributed rendering:
+    //   --worker <host> <port>                          render tiles for a coordinator
+    //   --coordinate <scene.txt> <port> [--no-local]    render a saved scene with the workers that connect, then export it
+    if (argc >= 4 && std::string(argv[1]) == "--worker") {
+        try {
+            return distributed::work(argv[2], std::atoi(argv[3])) ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << "Render error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--coordinate") {
+        try {
+            scene_desc scene_file = scene::load(argv[2]);
+            const auto& s = scene_file.settings;
+            vector<unsigned char> target(s.width * s.height * 3);
+            camera cam(s.width, s.height, target, s.fov, s.dof_angle, s.background, s.aa_factor, s.max_depth);
+
+            distributed_options options;
+            options.port = std::atoi(argv[3]);
+            options.render_locally = !(argc >= 5 && std::string(argv[4]) == "--no-local");
+            if (!distributed::coordinate(cam, scene_file, options)) {
+                return 1;
+            }
+            return cam.export_image(target, s.width, s.height, s.width * 3) ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << "Render error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     // Create application window
     WNDCLASSEXW wc = { sizeof(wc), CS_CLASSDC, WndProc, 0L, 0L, GetModuleHandle(nullptr), nullptr, nullptr, nullptr, nullptr, L"Rasterizer", nullptr };
     ::RegisterClassExW(&wc);
@@ -116,13 +132,79 @@ int main(int argc, char** argv) {
     unordered_map<std::string, shared_ptr<material>> materials_list;
     unordered_map<std::string, shared_ptr<objs>> objects_list;
     unordered_map<std::string, shared_ptr<world>> complex_objects_list;
-    vector<unsigned char> image(image_width * image_height * channels);
-    camera cam(image_width, image_height, image, FOV, dof_angle, background_col, aa_factor, max_recursion);
+    std::vector<AABB> dirty_bounds;         // Bounds of objects created or replaced since the last render
+    scene_desc scene_file;                  // Everything above as plain data, for Save Scene and distributed rendering
+    vector<unsigned char> image;                                                            // Displayed frame
+    vector<unsigned char> render_target(image_width * image_height * channels);             // Written by the render thread only
+    vector<unsigned char> golden_image;
+    camera cam(image_width, image_height, render_target, FOV, dof_angle, background_col, aa_factor, max_recursion);
+
+    // Background rendering: the render thread publishes every snapshot to display_buffer and
+    // the UI loop picks up the newest one each frame, so the UI never waits on the renderer
+    framebuffer display_buffer;
+    cam.set_display(&display_buffer);
+    std::thread render_thread;
+    std::atomic<bool> render_running{false};
+    std::atomic<bool> cancel_render{false};
+    int display_width  = image_width;
+    int display_height = image_height;
 
     // Variables for texture display
     ID3D11Texture2D* texture = nullptr;
     ID3D11ShaderResourceView* texture_srv = nullptr;
 
+    // Replaces the preview texture with the displayed frame
+    auto upload_texture = [&]() {
+        if (texture_srv) {
+            texture_srv->Release();
+            texture_srv = nullptr;
+        }
+        if (texture) {
+            texture->Release();
+            texture = nullptr;
+        }
+
+        // Create texture from the displayed image (RGB format)
+        D3D11_TEXTURE2D_DESC desc   = {};
+        desc.Width                  = display_width;
+        desc.Height                 = display_height;
+        desc.MipLevels              = 1;
+        desc.ArraySize              = 1;
+        desc.Format                 = DXGI_FORMAT_R8G8B8A8_UNORM;
+        desc.SampleDesc.Count       = 1;
+        desc.Usage                  = D3D11_USAGE_DEFAULT;
+        desc.BindFlags              = D3D11_BIND_SHADER_RESOURCE;
+
+        vector<unsigned char> packed_image(display_width * display_height * 4);
+        for (int i = 0; i < display_width * display_height; i++) {
+            packed_image[i * 4 + 0] = image[i * 3 + 0]; // R
+            packed_image[i * 4 + 1] = image[i * 3 + 1]; // G
+            packed_image[i * 4 + 2] = image[i * 3 + 2]; // B
+            packed_image[i * 4 + 3] = 255;              // A (fully opaque)
+        }
+
+        D3D11_SUBRESOURCE_DATA subResource = {};
+        subResource.pSysMem = packed_image.data();
+        subResource.SysMemPitch = display_width * 4;
+
+        HRESULT hr = g_pd3dDevice->CreateTexture2D(&desc, &subResource, &texture);
+        if (SUCCEEDED(hr)) {
+            D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+            srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+            srvDesc.Texture2D.MipLevels = desc.MipLevels;
+            hr = g_pd3dDevice->CreateShaderResourceView(texture, &srvDesc, &texture_srv);
+
+            if (FAILED(hr)) {
+                texture->Release();
+                texture = nullptr;
+            }
+
+        } else {
+            std::cerr << "Failed to create texture, HRESULT: 0x" << std::hex << hr << std::endl;
+        }
+    };
+
     // Main loop
     bool done = false;
     while (!done) {
@@ -136,6 +218,27 @@ int main(int argc, char** argv) {
         if (done)
             break;
 
+        // Poll the render thread: show its newest snapshot, and wrap up once it has finished.
+        // The final snapshot is published before render_running drops, so it is picked up below.
+        bool render_finished = render_thread.joinable() && !render_running;
+        if (display_buffer.acquire()) {
+            const frame& latest = display_buffer.front();
+            display_width  = latest.width;
+            display_height = latest.height;
+            image          = latest.pixels;
+            upload_texture();
+        }
+        if (render_finished) {
+            render_thread.join();
+
+            // Report the accuracy impact against the stored golden image
+            if (golden_image.size() == image.size()) {
+                auto diff = utils::compare_images(golden_image, image);
+                std::clog << "Golden comparison: RMSE " << diff.rmse << ", PSNR " << diff.psnr
+                          << " dB, max diff " << diff.max_abs << '\n';
+            }
+        }
+
         // Start the Dear ImGui frame
         ImGui_ImplDX11_NewFrame();
         ImGui_ImplWin32_NewFrame();
@@ -168,26 +271,18 @@ int main(int argc, char** argv) {
 
         // // Create Material and add it to the list
         if (ImGui::Button("Create Material")) {
-            vec3 albedo_vec(albedo[0], albedo[1], albedo[2]);
-            std::shared_ptr<material> mat;
-            
-            switch(current_material) {
-                case 0: mat = std::make_shared<diffuse>(albedo_vec); break;
-                case 1: mat = fuzz_or_refraction ? std::make_shared<metal>(albedo_vec, fuzz_or_refraction) 
-                                                : std::make_shared<metal>(albedo_vec); break;
-                case 2: mat = std::make_shared<dielectric>(fuzz_or_refraction); break;
-                case 3: mat = std::make_shared<Bulb>(albedo_vec); break;
-                case 4: {
-                    auto mat_texture = make_shared<ImageTexture>(tex_path);
-                    mat = make_shared<diffuse>(mat_texture);
-                    break;
-                }
-            }
-            
-            materials_list[material_name] = mat;
+            material_desc desc;
+            desc.name    = material_name;
+            desc.type    = material_types[current_material];
+            desc.albedo  = vec3(albedo[0], albedo[1], albedo[2]);
+            desc.param   = fuzz_or_refraction;
+            desc.texture = tex_path;
+
+            materials_list[material_name] = scene::make_material(desc);
+            scene_file.set_material(desc);
         }
 
-        // // Remove Material by Name
+        // // Remove Material by Name (objects already using it keep it, so it stays in scene_file)
         static char remove_name[256] = "";
         ImGui::InputText("Remove", remove_name, sizeof(remove_name));
         if (ImGui::Button("Remove Material")) {
@@ -257,38 +352,37 @@ int main(int argc, char** argv) {
 
         // // Create Material
         if (ImGui::Button("Create Object")) {
-            std::shared_ptr<objs> object;
-            auto material_name = material_names[material_index];
-            auto mat = materials_list[material_name];
-            auto where = vec3(position[0], position[1], position[2]);
-            
-            switch(current_object_type) {
-                case 0: {
-                    // Sphere
-                    object = make_shared<sphere>(radius, where, mat);
-                    object->rotate(x_rotation, 'x');
-                    object->rotate(y_rotation, 'y');
-                    objects_list[object_name] = object;
-                    break;
-                }
-                case 1: {
-                    // Quad
-                    object = make_shared<Quad>(where, vec3(quad_u[0], quad_u[1], quad_u[2]), vec3(quad_v[0], quad_v[1], quad_v[2]), mat);
-                    object->rotate(x_rotation, 'x');
-                    object->rotate(y_rotation, 'y');
-                    objects_list[object_name] = object;
-                    break;
-                }
-                case 2: {
-                    // Box
-                    std::shared_ptr<world> complex_object;
-                    complex_object = box(where, vec3(position2[0], position2[1], position2[2]), mat);
-                    complex_object->rotate(x_rotation, 'x');
-                    complex_object->rotate(y_rotation, 'y');
-                    complex_objects_list[object_name] = complex_object;
-                    break;
-                }
+            object_desc desc;
+            desc.name       = object_name;
+            desc.type       = object_types[current_object_type];
+            desc.material   = material_names[material_index];
+            desc.position   = vec3(position[0], position[1], position[2]);
+            desc.radius     = radius;
+            desc.u          = vec3(quad_u[0], quad_u[1], quad_u[2]);
+            desc.v          = vec3(quad_v[0], quad_v[1], quad_v[2]);
+            desc.position2  = vec3(position2[0], position2[1], position2[2]);
+            desc.x_rotation = x_rotation;
+            desc.y_rotation = y_rotation;
+
+            // An object replaced under the same name leaves its old footprint dirty as well
+            if (objects_list.count(object_name)) {
+                dirty_bounds.push_back(objects_list[object_name]->bounding_volume());
+            }
+            if (complex_objects_list.count(object_name)) {
+                dirty_bounds.push_back(complex_objects_list[object_name]->bounding_volume());
+            }
+
+            // Boxes come back as a world of quads
+            auto object = scene::make_object(desc, materials_list[desc.material]);
+            objects_list.erase(object_name);
+            complex_objects_list.erase(object_name);
+            if (auto complex_object = std::dynamic_pointer_cast<world>(object)) {
+                complex_objects_list[object_name] = complex_object;
+            } else {
+                objects_list[object_name] = object;
             }
+            dirty_bounds.push_back(object->bounding_volume());
+            scene_file.set_object(desc);
         }
         ImGui::Separator();
 
@@ -297,14 +391,9 @@ int main(int argc, char** argv) {
         // Camera
         ImGui::Text("World/Camera Settings:");
 
-        // // Image Size
-        if (ImGui::SliderInt("Width", &image_width, 100, 2048)) {
-            // Resize image vector when dimensions change
-            image.resize(image_width * image_height * channels);
-        }
-        if (ImGui::SliderInt("Height", &image_height, 100, 2048)) {
-            image.resize(image_width * image_height * channels);
-        }
+        // // Image Size (applied with Save Changes)
+        ImGui::SliderInt("Width", &image_width, 100, 2048);
+        ImGui::SliderInt("Height", &image_height, 100, 2048);
 
         // // Camera Position
         static int camera_position_arr[3] = {0, 0, 0};
@@ -333,21 +422,147 @@ int main(int argc, char** argv) {
         // // Recursion depth
         ImGui::InputInt("Recursion depth", &max_recursion);
 
-        // // Finalize Settings
+        // // Tile scheduling
+        static int tile_size = 32;
+        ImGui::InputInt("Tile Size", &tile_size);
+        static const char* tile_orders[] = { "scanline", "morton", "spiral" };
+        static int current_tile_order = 1;
+        ImGui::Combo("Tile Order", &current_tile_order, tile_orders, IM_ARRAYSIZE(tile_orders));
+
+        // // Path tracing engine
+        static const char* engines[] = { "megakernel", "wavefront", "bidirectional" };
+        static int current_engine = 0;
+        ImGui::Combo("Engine", &current_engine, engines, IM_ARRAYSIZE(engines));
+        static bool light_sampling = true;
+        ImGui::Checkbox("Light Sampling", &light_sampling);
+        static bool sort_by_material = false;
+        ImGui::Checkbox("Sort by Material", &sort_by_material);
+
+        // // Caustics: photons traced from the lights through mirrors and glass, gathered at diffuse hits
+        static bool caustics = false;
+        static int caustic_photons = 200000;
+        static float caustic_radius = 0.1f;
+        ImGui::Checkbox("Caustics (Photon Map)", &caustics);
+        if (caustics) {
+            ImGui::InputInt("Caustic Photons", &caustic_photons);
+            ImGui::InputFloat("Caustic Radius", &caustic_radius);
+        }
+
+        // // Progressive rendering: the AA-Factor is split over this many passes, each publishing a snapshot
+        static int progressive_passes = 1;
+        ImGui::InputInt("Progressive Passes", &progressive_passes);
+        static bool path_guiding = false;
+        ImGui::Checkbox("Path Guiding", &path_guiding);
+
+        // // Resampled preview: AA-Factor passes of one sample per pixel, direct light by reservoir resampling (ReSTIR)
+        static bool restir_preview = false;
+        ImGui::Checkbox("Resampled Preview", &restir_preview);
+
+        // // Adaptive sampling: the AA-Factor becomes the average sample budget per pixel
+        static bool adaptive_sampling = false;
+        static int adaptive_min_spp = 16;
+        static float adaptive_noise_target = 0.02f;
+        ImGui::Checkbox("Adaptive Sampling", &adaptive_sampling);
+        if (adaptive_sampling) {
+            ImGui::InputInt("Min Samples", &adaptive_min_spp);
+            ImGui::InputFloat("Noise Target", &adaptive_noise_target);
+        }
+
+        // // Output: tone mapping of the HDR film, and the AOV planes (albedo, normal, depth, sample count)
+        static const char* tone_operators[] = { "clamp", "reinhard", "aces" };
+        static int current_tone_operator = 0;
+        static float exposure = 1.0f;
+        static bool collect_aovs = false;
+        static const char* display_planes[] = { "beauty", "albedo", "normal", "depth", "sample count" };
+        static int current_display_plane = 0;
+        bool output_changed = ImGui::Combo("Tone Mapping", &current_tone_operator, tone_operators, IM_ARRAYSIZE(tone_operators));
+        output_changed |= ImGui::InputFloat("Exposure", &exposure);
+        ImGui::Checkbox("Collect AOVs", &collect_aovs);
+        static bool denoise = false;
+        ImGui::Checkbox("Denoise", &denoise);
+        if (collect_aovs) {
+            output_changed |= ImGui::Combo("Show Plane", &current_display_plane, display_planes, IM_ARRAYSIZE(display_planes));
+        }
+        if (output_changed && !render_running) {
+            // Re-develop the last render; no re-rendering needed
+            cam.set_tone_mapping(static_cast<tone_operator>(current_tone_operator), exposure);
+            cam.set_display_plane(static_cast<aov>(current_display_plane));
+            cam.develop();
+        }
+
+        // // Region of interest: only the pixels [x0, x1) x [y0, y1) are rendered
+        static bool use_crop = false;
+        static int crop_rect[4] = {0, 0, 400, 400};
+        ImGui::Checkbox("Crop", &use_crop);
+        if (use_crop) {
+            ImGui::InputInt4("Crop x0, y0, x1, y1", crop_rect);
+        }
+
+        // // Incremental re-render: after creating objects, only the tiles they cover (plus a margin) are rendered again
+        static bool incremental = false;
+        static int dirty_margin = 16;
+        ImGui::Checkbox("Incremental Re-render", &incremental);
+        if (incremental) {
+            ImGui::InputInt("Dirty Margin (px)", &dirty_margin);
+        }
+
+        // // Distributed rendering: workers started with --worker <this host> <port> join while the render runs
+        static bool distributed_render = false;
+        static int distributed_port = 5555;
+        ImGui::Checkbox("Distributed", &distributed_render);
+        if (distributed_render) {
+            ImGui::InputInt("Port", &distributed_port);
+        }
+
+        // // Render limits: a best-effort image is kept at the time limit or once the budget (average spp over the
+        // // rendered pixels) is spent. Only plain renders run under them; the modes above run to their own end.
+        static float time_limit_s = 0.0f;
+        static int sample_budget_spp = 0;
+        const bool limited_render = !distributed_render && !incremental && !restir_preview && !adaptive_sampling && progressive_passes <= 1;
+        ImGui::BeginDisabled(!limited_render);
+        ImGui::InputFloat("Time Limit (s)", &time_limit_s);
+        ImGui::InputInt("Sample Budget (spp)", &sample_budget_spp);
+        ImGui::EndDisabled();
+        if (!limited_render) {
+            ImGui::TextDisabled("Limits apply to plain renders only");
+        }
+
+        // // Finalize Settings. The camera belongs to the render thread while a render runs.
+        ImGui::BeginDisabled(render_running);
         if(ImGui::Button("Save Changes")) {
-            image.resize(image_width * image_height * channels);
+            auto& settings      = scene_file.settings;
+            settings.width      = image_width;
+            settings.height     = image_height;
+            settings.fov        = FOV;
+            settings.dof_angle  = dof_angle;
+            settings.aa_factor  = aa_factor;
+            settings.max_depth  = max_recursion;
+            settings.background = background_col;
+
+            render_target.assign(image_width * image_height * channels, 0);
             cam.~camera();
-            new(&cam) camera(image_width, image_height, image, FOV, dof_angle, background_col, aa_factor, max_recursion);
+            new(&cam) camera(image_width, image_height, render_target, FOV, dof_angle, background_col, aa_factor, max_recursion);
+            cam.set_display(&display_buffer);
         }
+        ImGui::EndDisabled();
         ImGui::Separator();
 
 
         
         // Render controls
-        if (ImGui::Button("Render Image")) {
+        // // Approximate transcendentals (see src/fastmath.h for error bounds)
+        static bool fast_math = fastmath::enabled();
+        if (ImGui::Checkbox("Fast Math", &fast_math)) {
+            fastmath::set_enabled(fast_math);
+        }
+
+        if (render_running) {
+            // Esc works as well as the button
+            if (ImGui::Button("Cancel Render") || ImGui::IsKeyPressed(ImGuiKey_Escape)) {
+                cancel_render = true;
+            }
+        } else if (ImGui::Button("Render Image")) {
             try {
-                // Clear the image
-                std::fill(image.begin(), image.end(), 0);
                 world_list.wipe();
 
                 // Fill objs to world list
@@ -366,53 +581,95 @@ int main(int argc, char** argv) {
                 }
                 
                 // Initialize renderer with current settings
-                cam.render(world_list, camera_position, lookat);
-                
-                // Update texture for display
-                if (texture) {
-                    texture->Release();
-                    texture = nullptr;
+                cam.set_tiling(tile_size, static_cast<tile_order>(current_tile_order));
+                cam.set_engine(static_cast<render_engine>(current_engine));
+                cam.set_light_sampling(light_sampling);
+                cam.set_path_guiding(path_guiding);
+                photon_settings caustic_settings;
+                caustic_settings.photons = std::max(0, caustic_photons);
+                caustic_settings.radius = std::max(1e-3f, caustic_radius);
+                cam.set_caustics(caustics, caustic_settings);
+                cam.set_material_sorting(sort_by_material);
+                cam.set_aovs(collect_aovs);
+                cam.set_denoising(denoise);
+                cam.set_tone_mapping(static_cast<tone_operator>(current_tone_operator), exposure);
+                cam.set_display_plane(static_cast<aov>(current_display_plane));
+                if (use_crop) {
+                    cam.set_crop(crop_rect[0], crop_rect[1], crop_rect[2], crop_rect[3]);
+                } else {
+                    cam.clear_crop();
                 }
-                
-                // Create texture from rendered image (RGB format)
-                D3D11_TEXTURE2D_DESC desc   = {};
-                desc.Width                  = image_width;
-                desc.Height                 = image_height;
-                desc.MipLevels              = 1;
-                desc.ArraySize              = 1;
-                desc.Format                 = DXGI_FORMAT_R8G8B8A8_UNORM;
-                desc.SampleDesc.Count       = 1;
-                desc.Usage                  = D3D11_USAGE_DEFAULT;
-                desc.BindFlags              = D3D11_BIND_SHADER_RESOURCE;
-                
-                vector<unsigned char> packed_image(image_width * image_height * 4);
-                for (int i = 0; i < image_width * image_height; i++) {
-                    packed_image[i * 4 + 0] = image[i * 3 + 0]; // R
-                    packed_image[i * 4 + 1] = image[i * 3 + 1]; // G
-                    packed_image[i * 4 + 2] = image[i * 3 + 2]; // B
-                    packed_image[i * 4 + 3] = 255;              // A (fully opaque)
+                std::vector<AABB> edited;
+                if (incremental) {
+                    edited.swap(dirty_bounds);
                 }
-                
-                D3D11_SUBRESOURCE_DATA subResource = {};
-                subResource.pSysMem = packed_image.data();
-                subResource.SysMemPitch = image_width * 4;
-                
-                HRESULT hr = g_pd3dDevice->CreateTexture2D(&desc, &subResource, &texture);
-                if (SUCCEEDED(hr)) {
-                    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-                    srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-                    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-                    srvDesc.Texture2D.MipLevels = desc.MipLevels;
-                    hr = g_pd3dDevice->CreateShaderResourceView(texture, &srvDesc, &texture_srv);
-
-                    if (FAILED(hr)) {
-                        texture->Release();
-                        texture = nullptr;
+                dirty_bounds.clear();
+
+                // Distributed renders rebuild the world from the scene description, like the workers do
+                scene_desc distributed_scene = scene_file;
+                distributed_scene.settings.camera_position = camera_position;
+                distributed_scene.settings.lookat          = lookat;
+                distributed_scene.settings.engine          = current_engine;
+                distributed_scene.settings.light_sampling  = light_sampling;
+                distributed_options distributed_setup;
+                distributed_setup.port      = distributed_port;
+                distributed_setup.tile_size = tile_size;
+
+                // Render in the background. The thread gets its own copies of the scene and of every setting,
+                // so the UI can keep editing them; only cam and cancel_render are shared.
+                cancel_render  = false;
+                render_running = true;
+                render_thread = std::thread([&cam, &cancel_render, &render_running, scene = world_list, camera_position, lookat,
+                                             aa_factor,
+                                             time_limit_s = time_limit_s, sample_budget_spp = sample_budget_spp,
+                                             adaptive_sampling = adaptive_sampling, adaptive_min_spp = adaptive_min_spp,
+                                             adaptive_noise_target = adaptive_noise_target, progressive_passes = progressive_passes, restir_preview = restir_preview,
+                                             incremental = incremental, edited = std::move(edited), dirty_margin = dirty_margin,
+                                             distributed_render = distributed_render, distributed_scene = std::move(distributed_scene),
+                                             distributed_setup]() {
+                    try {
+                        if (distributed_render) {
+                            // Runs until every tile is merged; Cancel Render does not apply
+                            distributed::coordinate(cam, distributed_scene, distributed_setup);
+                        } else if (incremental) {
+                            cam.rerender(scene, camera_position, lookat, edited, std::max(0, dirty_margin), [&cancel_render] {
+                                return static_cast<bool>(cancel_render);
+                            });
+                        } else if (restir_preview) {
+                            cam.render_restir(scene, camera_position, lookat, std::max(1, aa_factor), [&cancel_render](int pass, int passes) {
+                                std::clog << "\rPass " << pass << "/" << passes << "        " << std::flush;
+                                return !cancel_render;
+                            });
+                        } else if (adaptive_sampling) {
+                            cam.render_adaptive(scene, camera_position, lookat, adaptive_min_spp, 8, adaptive_noise_target, [&cancel_render] {
+                                return static_cast<bool>(cancel_render);
+                            });
+                        } else if (progressive_passes > 1) {
+                            int spp_per_pass = std::max(1, aa_factor / progressive_passes);
+                            cam.render_progressive(scene, camera_position, lookat, progressive_passes, spp_per_pass, [&cancel_render](int pass, int passes) {
+                                std::clog << "\rPass " << pass << "/" << passes << "        " << std::flush;
+                                return !cancel_render;
+                            });
+                        } else {
+                            // Plain renders go through a job as well: without limits it runs to the full AA-Factor,
+                            // but it shows a preview right away and can be cancelled
+                            render_job job;
+                            job.deadline_ms = time_limit_s * 1000.0;
+                            job.sample_budget = static_cast<long long>(std::max(0, sample_budget_spp)) * cam.render_pixel_count();
+                            job.on_progress = [&job, &cancel_render](const render_progress& progress) {
+                                if (cancel_render) {
+                                    job.cancel();
+                                }
+                                std::clog << "\r" << phase_name(progress.phase) << ": " << progress.samples_done << " / " << progress.samples_target
+                                          << " samples, " << static_cast<int>(progress.elapsed_ms) << " ms        " << std::flush;
+                            };
+                            cam.render(scene, camera_position, lookat, job);
+                        }
+                    } catch (const std::exception& e) {
+                        std::cerr << "Render error: " << e.what() << std::endl;
                     }
-
-                } else {
-                    std::cerr << "Failed to create texture, HRESULT: 0x" << std::hex << hr << std::endl;
-                }
+                    render_running = false;
+                });
             } catch (const std::exception& e) {
                 // Handle errors - you might want to display this in the UI
                 std::cerr << "Render error: " << e.what() << std::endl;
@@ -422,11 +679,31 @@ int main(int argc, char** argv) {
         // Show preview image after rendering
         ImGui::Checkbox("Show Preview", &show_preview);
         
+        // Golden image for accuracy comparisons (e.g. exact vs fast math at a high AA-Factor)
+        if (ImGui::Button("Store as Golden")) {
+            golden_image = image;
+        }
+
+        // Scene file, e.g. for --coordinate. Holds the settings of the last Save Changes and the current view.
+        static char scene_path[256] = "scene.txt";
+        ImGui::InputText("Scene File", scene_path, sizeof(scene_path));
+        if (ImGui::Button("Save Scene")) {
+            scene_file.settings.camera_position = camera_position;
+            scene_file.settings.lookat          = lookat;
+            scene_file.settings.engine          = current_engine;
+            scene_file.settings.light_sampling  = light_sampling;
+            if (scene::save(scene_file, scene_path)) {
+                std::clog << "Scene saved as " << scene_path << '\n';
+            } else {
+                std::cerr << "Failed to save scene.\n";
+            }
+        }
+
         // Export button
         if (ImGui::Button("Export PNG")) {
             if (!image.empty()) {
-                int stride = image_width * channels;
-                cam.export_image(image, image_width, image_height, stride);
+                int stride = display_width * channels;
+                cam.export_image(image, display_width, display_height, stride);
             }
         }
         
@@ -438,7 +715,7 @@ int main(int argc, char** argv) {
             
             // Maintain window aspect ratio
             ImVec2 window_size = ImGui::GetContentRegionAvail();
-            float aspect_ratio = (float)image_width / (float)image_height;
+            float aspect_ratio = (float)display_width / (float)display_height;
             ImVec2 display_size;
             
             if (window_size.x / aspect_ratio <= window_size.y) {
@@ -463,6 +740,10 @@ int main(int argc, char** argv) {
     }
 
     // Cleanup
+    cancel_render = true;
+    if (render_thread.joinable()) {
+        render_thread.join();
+    }
     if (texture) texture->Release();
     if (texture_srv) texture_srv->Release();
     
@@ -556,7 +837,7 @@ LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     return ::DefWindowProcW(hWnd, msg, wParam, lParam);
 }
 
-// g++ -fopenmp -I src -o raytracer main.cpp src/vec3.cpp src/color.cpp src/env.cpp src/ray.cpp src/util.cpp src/objects/objs.cpp src/objects/sphere.cpp src/objects/quad.cpp src/objects/world.cpp src/material/material.cpp src/material/diffuse.cpp src/material/metal.cpp src/material/dielectric.cpp src/material/bulb.cpp src/texture/texture.cpp src/objects/bvh/aabb.cpp src/objects/bvh/bvh.cpp src/lib/imgui/imgui.cpp src/lib/imgui/imgui_demo.cpp src/lib/imgui/imgui_draw.cpp src/lib/imgui/imgui_tables.cpp src/lib/imgui/imgui_widgets.cpp src/lib/imgui/imgui_impl_win32.cpp src/lib/imgui/imgui_impl_dx11.cpp -ld3d11 -ldxgi -ld3dcompiler -lgdi32 -ldwmapi  
+// g++ -O2 -I src -o raytracer main.cpp src/vec3.cpp src/color.cpp src/env.cpp src/ray.cpp src/util.cpp src/fastmath.cpp src/sampling/warp.cpp src/sampling/lights.cpp src/sampling/guiding.cpp src/render/thread_pool.cpp src/render/topology.cpp src/render/tiles.cpp src/render/wavefront.cpp src/render/render_job.cpp src/render/framebuffer.cpp src/render/film.cpp src/render/tonemap.cpp src/render/denoise.cpp src/render/restir.cpp src/render/photons.cpp src/render/bdpt.cpp src/render/net.cpp src/render/distributed.cpp src/scene/scene.cpp src/objects/objs.cpp src/objects/sphere.cpp src/objects/quad.cpp src/objects/world.cpp src/material/material.cpp src/material/diffuse.cpp src/material/metal.cpp src/material/dielectric.cpp src/material/bulb.cpp src/texture/texture.cpp src/objects/bvh/aabb.cpp src/objects/bvh/bvh.cpp src/lib/imgui/imgui.cpp src/lib/imgui/imgui_demo.cpp src/lib/imgui/imgui_draw.cpp src/lib/imgui/imgui_tables.cpp src/lib/imgui/imgui_widgets.cpp src/lib/imgui/imgui_impl_win32.cpp src/lib/imgui/imgui_impl_dx11.cpp -ld3d11 -ldxgi -ld3dcompiler -lgdi32 -ldwmapi -lws2_32  
 
-// g++ -I src -o raytracer main.cpp src/vec3.cpp src/color.cpp src/env.cpp src/ray.cpp src/util.cpp src/objects/objs.cpp src/objects/sphere.cpp src/objects/quad.cpp src/objects/world.cpp src/material/material.cpp src/material/diffuse.cpp src/material/metal.cpp src/material/dielectric.cpp src/material/bulb.cpp src/texture/texture.cpp src/objects/bvh/aabb.cpp src/objects/bvh/bvh.cpp src/lib/imgui/imgui.cpp src/lib/imgui/imgui_demo.cpp src/lib/imgui/imgui_draw.cpp src/lib/imgui/imgui_tables.cpp src/lib/imgui/imgui_widgets.cpp src/lib/imgui/imgui_impl_win32.cpp src/lib/imgui/imgui_impl_dx11.cpp -ld3d11 -ldxgi -ld3dcompiler -lgdi32 -ldwmapi
+// g++ -I src -o raytracer main.cpp src/vec3.cpp src/color.cpp src/env.cpp src/ray.cpp src/util.cpp src/fastmath.cpp src/sampling/warp.cpp src/sampling/lights.cpp src/sampling/guiding.cpp src/render/thread_pool.cpp src/render/topology.cpp src/render/tiles.cpp src/render/wavefront.cpp src/render/render_job.cpp src/render/framebuffer.cpp src/render/film.cpp src/render/tonemap.cpp src/render/denoise.cpp src/render/restir.cpp src/render/photons.cpp src/render/bdpt.cpp src/render/net.cpp src/render/distributed.cpp src/scene/scene.cpp src/objects/objs.cpp src/objects/sphere.cpp src/objects/quad.cpp src/objects/world.cpp src/material/material.cpp src/material/diffuse.cpp src/material/metal.cpp src/material/dielectric.cpp src/material/bulb.cpp src/texture/texture.cpp src/objects/bvh/aabb.cpp src/objects/bvh/bvh.cpp src/lib/imgui/imgui.cpp src/lib/imgui/imgui_demo.cpp src/lib/imgui/imgui_draw.cpp src/lib/imgui/imgui_tables.cpp src/lib/imgui/imgui_widgets.cpp src/lib/imgui/imgui_impl_win32.cpp src/lib/imgui/imgui_impl_dx11.cpp -ld3d11 -ldxgi -ld3dcompiler -lgdi32 -ldwmapi -lws2_32
 // ./raytracer
\ No newline at end of file
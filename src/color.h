@@ -4,12 +4,18 @@
 #include <fstream>
 #include "vec3.h"
 #include "util.h"
+#include "fastmath.h"
 
 
 using color = vec3;
 void convert_to_255_scale(color &col);
 
+// Rec. 709 luminance of a linear color
+inline Real luminance(const color& col) {
+    return 0.2126 * col.x() + 0.7152 * col.y() + 0.0722 * col.z();
+}
+
 // Note: sRGB values are in [0, 1]
-double linear_to_srgb(double input);
+Real linear_to_srgb(Real input);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/*
+    Build-time configuration of the core. Every switch can be overridden from the
+    compiler command line, e.g. -DTRACEY_SINGLE_PRECISION or -DTRACEY_ENABLE_DOF=0.
+*/
+
+// Floating point type used for geometry and shading
+#ifdef TRACEY_SINGLE_PRECISION
+using Real = float;
+#else
+using Real = double;
+#endif
+
+// Compiles the depth-of-field render kernels. With 0, DOF settings are ignored.
+#ifndef TRACEY_ENABLE_DOF
+#define TRACEY_ENABLE_DOF 1
+#endif
+
+// Compiles texture lookups into the diffuse shading path. With 0, textured diffuse falls back to its albedo.
+#ifndef TRACEY_ENABLE_TEXTURES
+#define TRACEY_ENABLE_TEXTURES 1
+#endif
+
+namespace config {
+    constexpr bool single_precision = sizeof(Real) == sizeof(float);
+    constexpr bool enable_dof       = TRACEY_ENABLE_DOF != 0;
+    constexpr bool enable_textures  = TRACEY_ENABLE_TEXTURES != 0;
+}
+
+#endif
@@ -1,6 +1,6 @@
 #include "env.h"
 
-camera::camera(int width, int height, std::vector<unsigned char>& image, double fov, double dof_angle, const vec3& default_color, double aa_factor, double max_depth) : image_width(width),
+camera::camera(int width, int height, std::vector<unsigned char>& image, Real fov, Real dof_angle, const vec3& default_color, Real aa_factor, Real max_depth) : image_width(width),
                                                                                                                                     image_height(height),
                                                                                                                                     fov(fov),
                                                                                                                                     defocus_angle(dof_angle),
@@ -8,36 +8,134 @@ camera::camera(int width, int height, std::vector<unsigned char>& image, double
                                                                                                                                     aa_factor(aa_factor),
                                                                                                                                     depth(max_depth), image(image) {}
 
-double camera::get_emission_sx(double x, double y) {
-    return (2 * ((x + 0.5)/(image_width) - 0.5)) * tan(deg_to_rad(fov/2)) * aspect_ratio;
+namespace {
+    // Path vertex whose incident radiance is deposited into the guide once the path is done
+    struct guide_vertex {
+        int     leaf;
+        vec3    direction;
+        Real    pdf;
+        color   radiance;       // Radiance of the path up to and including the vertex's light sample
+        color   throughput;     // Throughput after scattering at the vertex
+    };
 }
 
-double camera::get_emission_sy(double x, double y) {
-    return (2 * (0.5 - ((y + 0.5) / image_height))) * tan(deg_to_rad(fov / 2));
-}
+color camera::ray_color(const ray& r, objs &world_list, int depth_level, aov_sample* aov, bool direct_done) const {
+    // Iterative path integrator: carries the path throughput instead of recursing once per bounce
+    thread_local std::vector<guide_vertex> guide_vertices;
+    guide_vertices.clear();
 
-color camera::ray_color(const ray& r, objs &world_list, int depth_level) const {
-    if (depth_level >= depth) {
-        return color(0, 0, 0);
-    }
-    hit_history hist;
+    color radiance   = color(0, 0, 0);
+    color throughput = color(1, 1, 1);
+    ray   current    = r;
+    Real  scatter_pdf = 0;      // Density the current ray was sampled with; 0 for camera rays and delta scattering
+    vec3  scatter_normal;       // Surface normal where it was sampled
+    const bool gather_caustics = !caustics.empty();
+    int   specular_run = -1;  // Specular bounces since the last scattering at a surface with a density (-1: none yet)
 
-    if (world_list.ray_hit(r, 1e-4, std::numeric_limits<double>::infinity(), hist)) {
-        auto attenuation_secondary = hist.material_->scatter(r, hist.normal, hist.intersection, hist.is_front, hist.u, hist.v);
-        auto attenuation = std::get<0>(attenuation_secondary);
-        auto secondary   = std::get<1>(attenuation_secondary);
-        auto emission    = hist.material_->emit(hist.intersection);
+    for (int bounce = depth_level; bounce < depth; bounce++) {
+        hit_history hist;
+        if (!world_list.ray_hit(current, 1e-4, std::numeric_limits<Real>::infinity(), hist)) {
+            if (aov && bounce == depth_level) {
+                *aov = aov_sample();
+                aov->albedo = scene_color;
+            }
+            radiance += hadamard(throughput, scene_color);
+            break;
+        }
+
+        if (aov && bounce == depth_level) {
+            *aov = {hist.material_->get_albedo(hist.u, hist.v, hist.intersection), hist.normal, hist.t, true};
+        }
 
         if (hist.material_->is_emissive()) {
-            // Check if the material is a light source using a sentinel vector
-            return emission;
+            // Light sources terminate the path. Emission that light sampling could also have found is MIS weighted.
+            if (direct_done && bounce == depth_level) {
+                break;
+            }
+            // Diffuse, then specular, then the light: the photon map has that light already
+            if (gather_caustics && specular_run > 0) {
+                break;
+            }
+            Real weight = sample_lights && scatter_pdf > 0 ? lights.emission_weight(current.get_origin(), scatter_normal, scatter_pdf, hist) : 1;
+            radiance += hadamard(throughput, hist.material_->emit(hist.intersection)) * weight;
+            break;
+        }
+
+        int leaf = guide && hist.material_->has_density() ? guide->locate(hist.intersection) : -1;
+        if (sample_lights) {
+            // Where the next direction comes from the guided mix, light samples are weighted against its density
+            color direct = leaf >= 0 && guide->trained(leaf)
+                               ? lights.sample_direct(world_list, hist, [&](const vec3& wi) { return guided_pdf(hist, leaf, wi); })
+                               : lights.sample_direct(world_list, hist);
+            radiance += hadamard(throughput, direct);
+        }
+        if (gather_caustics) {
+            radiance += hadamard(throughput, caustics.estimate(hist));
         }
 
-        auto rec = ray_color(secondary, world_list, depth_level + 1);
-        return vec3(rec.x() * attenuation.x(), rec.y() * attenuation.y(), rec.z() * attenuation.z()) + emission;
+        auto bs = leaf >= 0 ? sample_guided(current, hist, leaf)
+                            : hist.material_->sample(current, hist.normal, hist.intersection, hist.is_front, hist.u, hist.v);
+        color radiance_here = radiance;
+        throughput  = hadamard(throughput, bs.weight);
+        current     = bs.scattered;
+        scatter_pdf = bs.pdf;
+        scatter_normal = hist.normal;
+        specular_run = !bs.specular ? 0 : (specular_run >= 0 ? specular_run + 1 : -1);
+
+        // Russian roulette: after a few guaranteed bounces, continue with probability equal to the throughput
+        // (capped below 1 so that paths always terminate) and compensate the survivors
+        if (bounce + 1 - depth_level >= rr_start_depth) {
+            Real survive = std::fmin(max_component(throughput), Real(0.95));
+            if (random_double(0, 1) >= survive) {
+                break;
+            }
+            throughput /= survive;
+        }
+
+        if (guide_training && leaf >= 0 && bs.pdf > 0) {
+            guide_vertices.push_back({leaf, current.get_direction(), bs.pdf, radiance_here, throughput});
+        }
+    }
+
+    // Light that arrived at each vertex along its sampled direction: what the rest of the path gathered, undone by the
+    // throughput up to there, deposited over the density of the direction
+    for (const auto& v : guide_vertices) {
+        color gathered = radiance - v.radiance;
+        color incident(v.throughput.x() > 0 ? gathered.x() / v.throughput.x() : 0,
+                       v.throughput.y() > 0 ? gathered.y() / v.throughput.y() : 0,
+                       v.throughput.z() > 0 ? gathered.z() / v.throughput.z() : 0);
+        guide->record(v.leaf, v.direction, luminance(incident) / v.pdf);
     }
 
-    return scene_color;
+    return radiance;
+}
+
+bsdf_sample camera::sample_guided(const ray& r, const hit_history& hist, int leaf) const {
+    const material* mat = hist.material_.get();
+    if (!guide->trained(leaf)) {
+        return mat->sample(r, hist.normal, hist.intersection, hist.is_front, hist.u, hist.v);
+    }
+
+    // One-sample mixture of the learned distribution and the BSDF; the weight uses the density of the mixture
+    const Real fraction = guiding.guided_fraction;
+    bsdf_sample s;
+    vec3 wi;
+    if (random_double(0, 1) < fraction) {
+        wi = guide->sample(leaf, random_double(0, 1), random_double(0, 1));
+        s.scattered = ray(hist.intersection, wi);
+    } else {
+        s = mat->sample(r, hist.normal, hist.intersection, hist.is_front, hist.u, hist.v);
+        wi = s.scattered.get_direction().unit_vector();
+    }
+    s.pdf = guided_pdf(hist, leaf, wi);
+    s.weight = s.pdf > 0 ? mat->eval(wi, hist.normal, hist.u, hist.v, hist.intersection) / s.pdf : color(0, 0, 0);
+    s.specular = false;
+    return s;
+}
+
+Real camera::guided_pdf(const hit_history& hist, int leaf, const vec3& wi) const {
+    const Real fraction = guiding.guided_fraction;
+    return fraction * guide->pdf(leaf, wi) + (1 - fraction) * hist.material_->pdf(wi, hist.normal);
 }
 
 void camera::preprocess(vec3 cam_pos, vec3 vision_pos, vec3 cam_up) {
@@ -45,85 +143,977 @@ void camera::preprocess(vec3 cam_pos, vec3 vision_pos, vec3 cam_up) {
     camera_pos          = cam_pos;
     focal_length        = (cam_pos - vision_pos).magnitude();
     viewport_height     = 2 * tan(deg_to_rad(fov)/2) * focal_length;
-    viewport_width      = viewport_height * (double(image_width)/image_height);
+    viewport_width      = viewport_height * (Real(image_width)/image_height);
     g_forward           = (cam_pos - vision_pos).unit_vector();
     g_right             = cross(cam_up, g_forward).unit_vector();
     g_up                = cross(g_forward, g_right);
+
+    // Screen-space basis: the pixel grid spans [-tan(fov/2) * aspect, tan(fov/2) * aspect] x [-tan(fov/2), tan(fov/2)] at unit distance
+    Real half_height    = fastmath::tan(deg_to_rad(fov / 2));
+    Real half_width     = half_height * aspect_ratio;
+    pixel_delta_u       = g_right * (2 * half_width / image_width);
+    pixel_delta_v       = g_up * (-2 * half_height / image_height);
+    pixel00_dir         = -1 * g_forward - half_width * g_right + half_height * g_up;
+    defocus_u           = g_right * defocus_radius;
+    defocus_v           = g_up * defocus_radius;
 }
 
 inline vec3 random_in_unit_disk() {
-    while (true) {
-        auto p = vec3(random_double(-1,1), random_double(-1,1), 0);
-        if (p.x() * p.x() + p.y() * p.y() < 1)
-            return p;
+    return warp::square_to_concentric_disk(random_double(0, 1), random_double(0, 1));
+}
+
+template <bool UseDOF, bool Jitter>
+void camera::generate_rays_kernel(int x0, int y0, int x1, int y1, int spp, ray_batch& batch) const {
+    const int n = (x1 - x0) * (y1 - y0) * spp;
+    batch.resize(n);
+
+    // Pass 1: pixel coordinates and jitter
+    int k = 0;
+    for (int j = y0; j < y1; ++j) {
+        for (int i = x0; i < x1; ++i) {
+            if constexpr (Jitter) {
+                seed_random(sample_seed(j * image_width + i, rng_stream::jitter));
+            }
+            for (int s = 0; s < spp; ++s, ++k) {
+                Real px = Jitter ? i + random_double(0, 1) : i + 0.5;
+                Real py = Jitter ? j + random_double(0, 1) : j + 0.5;
+                batch.pixel[k] = j * image_width + i;
+                batch.dx[k] = pixel00_dir.x() + px * pixel_delta_u.x() + py * pixel_delta_v.x();
+                batch.dy[k] = pixel00_dir.y() + px * pixel_delta_u.y() + py * pixel_delta_v.y();
+                batch.dz[k] = pixel00_dir.z() + px * pixel_delta_u.z() + py * pixel_delta_v.z();
+            }
+        }
+    }
+
+    // Pass 2: normalize and place origins, straight-line over the SoA lanes
+    for (int r = 0; r < n; ++r) {
+        Real inv_len = 1 / std::sqrt(batch.dx[r] * batch.dx[r] + batch.dy[r] * batch.dy[r] + batch.dz[r] * batch.dz[r]);
+        batch.dx[r] *= inv_len;
+        batch.dy[r] *= inv_len;
+        batch.dz[r] *= inv_len;
+        batch.ox[r] = camera_pos.x();
+        batch.oy[r] = camera_pos.y();
+        batch.oz[r] = camera_pos.z();
+    }
+
+    // Pass 3: thin-lens offsets. Rays still converge on the plane focus_dist away along each primary direction.
+    if constexpr (UseDOF) {
+        for (int r = 0; r < n; ++r) {
+            if (r % spp == 0) {
+                seed_random(sample_seed(batch.pixel[r], rng_stream::lens));
+            }
+            auto lens = random_in_unit_disk();
+            Real fx = camera_pos.x() + focus_dist * batch.dx[r];
+            Real fy = camera_pos.y() + focus_dist * batch.dy[r];
+            Real fz = camera_pos.z() + focus_dist * batch.dz[r];
+            batch.ox[r] += lens.x() * defocus_u.x() + lens.y() * defocus_v.x();
+            batch.oy[r] += lens.x() * defocus_u.y() + lens.y() * defocus_v.y();
+            batch.oz[r] += lens.x() * defocus_u.z() + lens.y() * defocus_v.z();
+            batch.dx[r] = fx - batch.ox[r];
+            batch.dy[r] = fy - batch.oy[r];
+            batch.dz[r] = fz - batch.oz[r];
+        }
     }
 }
 
-void camera::render(const world& w, const vec3& cam, const vec3& look) {
+void camera::generate_rays(int x0, int y0, int x1, int y1, int spp, ray_batch& batch) const {
+    if (spp <= 1) {
+        generate_rays_kernel<false, false>(x0, y0, x1, y1, 1, batch);
+    } else if (config::enable_dof && defocus_angle > 0) {
+        generate_rays_kernel<config::enable_dof, true>(x0, y0, x1, y1, spp, batch);
+    } else {
+        generate_rays_kernel<false, true>(x0, y0, x1, y1, spp, batch);
+    }
+}
+
+template <bool UseDOF, bool Jitter>
+void camera::render_tile(const tile& t, int spp) {
+    const int band_rows = std::max(1, std::min(t.y1 - t.y0, max_batch_rays / std::max(1, t.x1 - t.x0)));
+    for (int y0 = t.y0; y0 < t.y1; y0 += band_rows) {
+        const tile band = {t.x0, y0, t.x1, std::min(t.y1, y0 + band_rows)};
+        // Each chunk is accumulated before the next is generated, so pixel_spp moves the chunks' random streams on
+        const int chunk_spp = std::max(1, max_batch_rays / band.pixel_count());
+        for (int done = 0; done < spp; done += chunk_spp) {
+            render_batch<UseDOF, Jitter>(band, std::min(chunk_spp, spp - done));
+        }
+    }
+}
+
+template <bool UseDOF, bool Jitter>
+void camera::render_batch(const tile& t, int spp) {
+    const int channels = 3;
+
+    // All primary rays of the batch, spp consecutive rays per pixel
+    ray_batch batch;
+    generate_rays_kernel<UseDOF, Jitter>(t.x0, t.y0, t.x1, t.y1, spp, batch);
+
+    // One radiance estimate per primary ray, plus its first hit when AOVs are collected
+    std::vector<color> samples;
+    std::vector<aov_sample> aovs;
+    if (engine == render_engine::wavefront) {
+        // Paths interleave their random numbers here, so the stream is seeded once per batch: still deterministic
+        // for a fixed tiling, whichever worker renders the tile
+        seed_random(sample_seed(t.y0 * image_width + t.x0, rng_stream::path));
+        wavefront_integrator integrator(world_list, scene_color, depth, rr_start_depth, sort_by_material, sample_lights ? &lights : nullptr, &caustics);
+        integrator.trace(batch, samples, collect_aovs ? &aovs : nullptr);
+    } else if (engine == render_engine::bidirectional) {
+        bdpt_integrator integrator(world_list, bdpt_lights, scene_color, depth, rr_start_depth);
+        samples.resize(batch.size());
+        aovs.resize(collect_aovs ? batch.size() : 0);
+        for (int k = 0; k < batch.size(); k++) {
+            seed_random(sample_seed(batch.pixel[k], rng_stream::path, k % spp));
+            samples[k] = integrator.trace(batch.get(k), collect_aovs ? &aovs[k] : nullptr);
+        }
+    } else {
+        samples.resize(batch.size());
+        if (collect_aovs) {
+            aovs.resize(batch.size());
+        }
+        for (int k = 0; k < batch.size(); k++) {
+            // Every path gets its own stream, keyed by pixel and sample number
+            seed_random(sample_seed(batch.pixel[k], rng_stream::path, k % spp));
+            samples[k] = ray_color(batch.get(k), world_list, 0, collect_aovs ? &aovs[k] : nullptr);
+        }
+    }
+
+    int k = 0;
+    for (int j = t.y0; j < t.y1; ++j) {
+        for (int i = t.x0; i < t.x1; ++i) {
+            color c = vec3(0, 0, 0);
+            Real lum_sq = 0;
+            for (int s = 0; s < spp; s++, k++) {
+                const auto& sample = samples[k];
+                auto lum = luminance(sample);
+                c += sample;
+                lum_sq += lum * lum;
+            }
+
+            int pixel = j * image_width + i;
+            int pixel_index = pixel * channels;
+            if (collect_aovs) {
+                for (int s = k - spp; s < k; s++) {
+                    accumulate_aov(pixel, aovs[s]);
+                }
+            }
+            accum[pixel_index + 0] += static_cast<float>(c.x());
+            accum[pixel_index + 1] += static_cast<float>(c.y());
+            accum[pixel_index + 2] += static_cast<float>(c.z());
+            accum_lum_sq[pixel] += static_cast<float>(lum_sq);
+            pixel_spp[pixel] += spp;
+        }
+    }
+}
+
+template <bool UseDOF, bool Jitter>
+void camera::render_kernel(const std::vector<tile>& tiles, int spp) {
+    tile_timings.assign(tiles.size(), tile_stats());
+    std::atomic<int> tiles_done{0};
+
+    pool.parallel_for(static_cast<int>(tiles.size()), [&](int index, int worker) {
+        if (active_job && (active_job->cancelled() || (job_phase != render_phase::preview && active_job->past_deadline()))) {
+            return;
+        }
+        if (stop_requested && stop_requested()) {
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        render_tile<UseDOF, Jitter>(tiles[index], spp);
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        tile_timings[index] = {tiles[index], elapsed, worker};
+        samples_traced += static_cast<long long>(tiles[index].pixel_count()) * spp;
+
+        int done = ++tiles_done;
+        if (active_job) {
+            render_progress progress;
+            progress.phase          = job_phase;
+            progress.samples_done   = samples_traced;
+            progress.samples_target = static_cast<long long>(aa_factor) * frame_pixels;
+            progress.tiles_done     = done;
+            progress.tiles_total    = static_cast<int>(tiles.size());
+            progress.elapsed_ms     = active_job->elapsed_ms();
+            active_job->report(progress);
+        } else if (log_progress) {
+            std::clog << "\rTiles remaining: " << static_cast<int>(tiles.size()) - done << ' ' << std::flush;
+        }
+    });
+}
+
+void camera::begin_frame(const world& w, const vec3& cam, const vec3& look) {
     preprocess(cam, look, vec3(0,1,0));
     world_list = w;
+    lights.build(world_list);
+    bdpt_lights.build(world_list);
+    build_caustics();
+    guide.reset();
+
+    const int channels = 3;
+    const size_t pixels = static_cast<size_t>(image_width) * image_height;
+    accum.allocate(pixels * channels);
+    accum_lum_sq.allocate(pixels);
+    pixel_spp.allocate(pixels);
+    accum_aov.allocate(collect_aovs ? pixels * aov_stride : 0);
+
+    // First touch: the pool zeroes the buffers tile by tile, dealt like the render passes, so every page is
+    // placed on the NUMA node of a worker that renders it (pages shared by neighbouring tiles go to one of them)
+    clear_tiles(make_tiles(image_width, image_height, tile_size, order));
+
+    hdr.resize(image_width, image_height, collect_aovs);
+    samples_traced = 0;
+
+    has_frame = true;
+    frame_cam = cam;
+    frame_look = look;
+    frame_pixels = render_pixel_count();
+    frame_use_crop = use_crop;
+    frame_crop = crop;
+}
+
+void camera::build_caustics() {
+    // Bidirectional paths find caustics through their own connections
+    if (!use_caustics || engine == render_engine::bidirectional) {
+        caustics.clear();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    caustics.build(world_list, caustic_settings, pool, frame_seed);
+    caustics_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void camera::accumulate_aov(int pixel, const aov_sample& a) {
+    float* sums = &accum_aov[static_cast<size_t>(pixel) * aov_stride];
+    sums[0] += a.albedo.x(); sums[1] += a.albedo.y(); sums[2] += a.albedo.z();
+    if (a.hit) {
+        sums[3] += a.normal.x(); sums[4] += a.normal.y(); sums[5] += a.normal.z();
+        sums[6] += a.depth;
+        sums[7] += 1;
+    }
+}
+
+std::vector<tile> camera::frame_tiles() const {
+    auto tiles = make_tiles(image_width, image_height, tile_size, order);
+    return use_crop ? clip_tiles(tiles, crop) : tiles;
+}
+
+void camera::clear_tiles(const std::vector<tile>& tiles) {
+    const int channels = 3;
+    pool.parallel_for(static_cast<int>(tiles.size()), [&](int index, int) {
+        const auto& t = tiles[index];
+        for (int j = t.y0; j < t.y1; ++j) {
+            for (int i = t.x0; i < t.x1; ++i) {
+                int pixel = j * image_width + i;
+                std::fill_n(&accum[static_cast<size_t>(pixel) * channels], channels, 0.0f);
+                accum_lum_sq[pixel] = 0;
+                pixel_spp[pixel] = 0;
+                if (collect_aovs) {
+                    std::fill_n(&accum_aov[static_cast<size_t>(pixel) * aov_stride], aov_stride, 0.0f);
+                }
+            }
+        }
+    });
+}
+
+const char* camera::render_tiles(const std::vector<tile>& tiles, int spp, bool jitter) {
+    // Pick the kernel instantiation once, outside the pixel loop. Without jitter every sample goes through the pixel center.
+    bool use_dof = config::enable_dof && jitter && defocus_angle > 0;
+
+    if (!jitter) {
+        render_kernel<false, false>(tiles, spp);
+        return "single-sample";
+    } else if (!use_dof) {
+        render_kernel<false, true>(tiles, spp);
+        return "multi-sample";
+    } else {
+        render_kernel<config::enable_dof, true>(tiles, spp);
+        return "multi-sample + DOF";
+    }
+}
+
+const char* camera::render_pass(int spp, bool jitter) {
+    return render_tiles(frame_tiles(), spp, jitter);
+}
 
+Real camera::tile_error(const tile& t) const {
+    // Mean over the tile of the per-pixel standard error of the luminance mean, relative to the
+    // pixel's displayed brightness (clamped at white, with a floor so that black pixels do not dominate)
     const int channels = 3;
-    const int stride = image_width * channels;
+    Real error = 0;
+    for (int j = t.y0; j < t.y1; ++j) {
+        for (int i = t.x0; i < t.x1; ++i) {
+            int pixel = j * image_width + i;
+            int n = pixel_spp[pixel];
+            if (n < 2) {
+                return std::numeric_limits<Real>::infinity();
+            }
+
+            int pixel_index = pixel * channels;
+            Real mean = luminance(vec3(accum[pixel_index], accum[pixel_index + 1], accum[pixel_index + 2])) / n;
+            Real variance = std::fmax(0, (accum_lum_sq[pixel] / n - mean * mean) * n / (n - 1));
+            error += std::sqrt(variance / n) / (Real(0.1) + std::fmin(mean, Real(1)));
+        }
+    }
+    return error / t.pixel_count();
+}
+
+std::vector<int> camera::rank_tiles(const std::vector<tile>& tiles) {
+    std::vector<Real> errors(tiles.size());
+    pool.parallel_for(static_cast<int>(tiles.size()), [&](int index, int) {
+        errors[index] = tile_error(tiles[index]);
+    });
 
-    // OpenMP parallel rendering
-    #pragma omp parallel for schedule(dynamic, 1)
-    for (int j = 0; j < image_height; ++j) {
+    std::vector<int> ranked(tiles.size());
+    for (int t = 0; t < static_cast<int>(tiles.size()); t++) {
+        ranked[t] = t;
+    }
+    std::sort(ranked.begin(), ranked.end(), [&](int a, int b) { return errors[a] > errors[b]; });
+    return ranked;
+}
+
+void camera::resolve() {
+    const int channels = 3;
+
+    pool.parallel_for(image_height, [&](int j, int) {
         for (int i = 0; i < image_width; ++i) {
-            color c = vec3(0, 0, 0);
-            
-            if (aa_factor == 1) {
-                double sx = get_emission_sx(i, j);
-                double sy = get_emission_sy(i, j);
-                vec3 direction_camera = vec3(sx, sy, -1);
-                vec3 direction_world = (
-                    direction_camera.x() * g_right +
-                    direction_camera.y() * g_up +
-                    direction_camera.z() * g_forward
-                ).unit_vector();
-                ray r(camera_pos, direction_world);
-                c = ray_color(r, world_list, 0);
+            int pixel = j * image_width + i;
+            int pixel_index = pixel * channels;
+            const int n = pixel_spp[pixel];
+            const float inv_spp = 1.0f / std::max(1, n);
+
+            float* beauty = hdr.pixel(aov::beauty, i, j);
+            beauty[0] = accum[pixel_index + 0] * inv_spp;
+            beauty[1] = accum[pixel_index + 1] * inv_spp;
+            beauty[2] = accum[pixel_index + 2] * inv_spp;
+            beauty[3] = 1.0f;
+
+            if (collect_aovs) {
+                const float* sums = &accum_aov[static_cast<size_t>(pixel) * aov_stride];
+                const float hits = sums[7];
+                const float coverage = hits * inv_spp;
+                const float mean_depth = hits > 0 ? sums[6] / hits : 0.0f;
+
+                float* albedo = hdr.pixel(aov::albedo, i, j);
+                float* normal = hdr.pixel(aov::normal, i, j);
+                float* dist   = hdr.pixel(aov::depth, i, j);
+                float* count  = hdr.pixel(aov::sample_count, i, j);
+                for (int c = 0; c < 3; c++) {
+                    albedo[c] = sums[c] * inv_spp;
+                    normal[c] = sums[3 + c] * inv_spp;
+                    dist[c]   = mean_depth;
+                    count[c]  = static_cast<float>(n);
+                }
+                albedo[3] = coverage;
+                normal[3] = coverage;
+                dist[3]   = coverage;
+                count[3]  = 1.0f;
+            }
+        }
+    });
+
+    if (denoise_enabled && collect_aovs) {
+        auto start = std::chrono::steady_clock::now();
+
+        // Variance of every pixel's luminance mean. One sample gives no estimate, so its own square stands in.
+        std::vector<float> variance(static_cast<size_t>(image_width) * image_height);
+        pool.parallel_for(image_height, [&](int j, int) {
+            for (int i = 0; i < image_width; ++i) {
+                int pixel = j * image_width + i;
+                int n = pixel_spp[pixel];
+                float mean = luminance(vec3(accum[pixel * channels], accum[pixel * channels + 1], accum[pixel * channels + 2])) / std::max(1, n);
+                variance[pixel] = n < 2 ? mean * mean : std::max(0.0f, accum_lum_sq[pixel] / n - mean * mean) / (n - 1);
+            }
+        });
+        denoise::atrous(hdr, variance, pool, denoiser);
+        denoise_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    develop();
+}
+
+void camera::develop() {
+    if (hdr.get_width() != image_width || hdr.get_height() != image_height) {
+        return;     // Nothing rendered at this size yet
+    }
+    const aov plane = hdr.has(display_plane) ? display_plane : aov::beauty;
+
+    if (plane == aov::beauty) {
+        pool.parallel_for(image_height, [&](int j, int) {
+            tonemap::apply(hdr.pixel(aov::beauty, 0, j), &image[static_cast<size_t>(j) * image_width * 3], image_width, tone_op, exposure);
+        });
+    } else {
+        // Data planes are scaled into [0, 1] and shown through the clamp curve: normals from [-1, 1],
+        // depth and sample count relative to their maximum over the image
+        const auto& values = hdr.data(plane);
+        float scale = 1.0f;
+        float offset = 0.0f;
+        if (plane == aov::normal) {
+            scale = 0.5f;
+            offset = 0.5f;
+        } else if (plane == aov::depth || plane == aov::sample_count) {
+            float max_value = 0;
+            for (size_t v = 0; v < values.size(); v += 4) {
+                max_value = std::max(max_value, values[v]);
+            }
+            scale = max_value > 0 ? 1.0f / max_value : 1.0f;
+        }
+
+        pool.parallel_for(image_height, [&](int j, int) {
+            std::vector<float> row(static_cast<size_t>(image_width) * 4);
+            const float* src = hdr.pixel(plane, 0, j);
+            for (size_t v = 0; v < row.size(); v++) {
+                row[v] = src[v] * scale + offset;
+            }
+            tonemap::apply(row.data(), &image[static_cast<size_t>(j) * image_width * 3], image_width, tone_operator::clamp, 1.0f);
+        });
+    }
+
+    if (display) {
+        display->publish(image, image_width, image_height);
+    }
+}
+
+void camera::log_render(const char* kernel_name, double elapsed) const {
+    std::clog << "\rDone.                 \n";
+    std::clog << "Kernel: " << kernel_name << (config::single_precision ? " (float)" : " (double)")
+              << ", " << (engine == render_engine::wavefront ? (sort_by_material ? "wavefront (material-sorted)" : "wavefront (unsorted)")
+                          : engine == render_engine::bidirectional ? "bidirectional" : "megakernel") << " engine"
+              << ", " << (frame_pixels ? samples_traced / frame_pixels : 0) << " spp avg, " << elapsed << " ms on " << pool.size() << " threads\n";
+    std::clog << "Topology: " << topology::detect().describe() << "; threads " << (pool.pinned() ? "pinned to their nodes" : "unpinned")
+              << " across " << pool.node_count() << " node(s); scene data shared, not replicated per node\n";
+    if (sample_lights && !lights.empty()) {
+        std::clog << "Lights: " << lights.size() << " emitters in a light BVH of depth " << lights.depth() << '\n';
+    }
+    if (guide) {
+        std::clog << "Guiding: " << guide->leaf_count() << " leaves of depth up to " << guide->depth() << ", trained over "
+                  << guiding.training_passes << " passes\n";
+    }
+    if (!caustics.empty()) {
+        std::clog << "Caustics: " << caustics.size() << " of " << caustics.emitted() << " photons stored, radius "
+                  << caustic_settings.radius << ", built in " << caustics_ms << " ms\n";
+    }
+    if (denoise_enabled) {
+        std::clog << "Denoise: " << denoiser.passes << " a-trous passes, " << denoise_ms << " ms for the last resolve\n";
+    }
+
+    if (!tile_timings.empty()) {
+        auto slowest = std::max_element(tile_timings.begin(), tile_timings.end(),
+                                        [](const tile_stats& a, const tile_stats& b) { return a.ms < b.ms; });
+        double total = 0;
+        for (const auto& ts : tile_timings) {
+            total += ts.ms;
+        }
+        std::clog << "Tiles: " << tile_timings.size() << " x " << tile_size << "px, mean " << total / tile_timings.size()
+                  << " ms, slowest " << slowest->ms << " ms at (" << slowest->bounds.x0 << ", " << slowest->bounds.y0 << ")\n";
+    }
+}
+
+void camera::render(const world& w, const vec3& cam, const vec3& look) {
+    begin_frame(w, cam, look);
+
+    auto start = std::chrono::steady_clock::now();
+    const char* kernel_name = render_pass(static_cast<int>(aa_factor), aa_factor != 1);
+    resolve();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    log_render(kernel_name, elapsed);
+}
+
+void camera::render_progressive(const world& w, const vec3& cam, const vec3& look, int passes, int spp_per_pass,
+                                const std::function<bool(int, int)>& on_pass) {
+    begin_frame(w, cam, look);
+    const bool guided = use_guiding && engine == render_engine::megakernel;
+    if (guided) {
+        guide = std::make_unique<path_guide>(world_list.bounding_volume(), guiding);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const char* kernel_name = "none";
+    for (int p = 0; p < passes; p++) {
+        // Training passes feed the guide (and already sample what earlier passes taught it); it is rebuilt after each
+        guide_training = guided && p < guiding.training_passes;
+        kernel_name = render_pass(std::max(1, spp_per_pass), true);
+        if (guide_training) {
+            guide->update();
+            guide_training = false;
+        }
+
+        // Publish a displayable snapshot of everything accumulated so far
+        resolve();
+        if (on_pass && !on_pass(p + 1, passes)) {
+            break;
+        }
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    log_render(kernel_name, elapsed);
+}
+
+void camera::render_restir(const world& w, const vec3& cam, const vec3& look, int passes,
+                           const std::function<bool(int, int)>& on_pass, const restir_settings& settings) {
+    begin_frame(w, cam, look);
+    tile_timings.clear();
+    restir_integrator restir(world_list, lights, image_width, image_height, settings);
+
+    const int channels = 3;
+    const size_t pixels = static_cast<size_t>(image_width) * image_height;
+    std::vector<color> radiance(pixels);
+    std::vector<unsigned char> resampled(pixels);
+    auto tiles = frame_tiles();
+    const bool use_dof = config::enable_dof && defocus_angle > 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        // Stage 1: primary hits, initial candidates and temporal reuse. Pixels without a surface to resample
+        // (misses, emitters, mirrors and glass) take a regular path sample.
+        pool.parallel_for(static_cast<int>(tiles.size()), [&](int index, int) {
+            const auto& t = tiles[index];
+            ray_batch batch;
+            if (use_dof) {
+                generate_rays_kernel<config::enable_dof, true>(t.x0, t.y0, t.x1, t.y1, 1, batch);
             } else {
-                for (int k = 0; k < aa_factor; k++) {
-                    double u = (i + utils::random_double(0, .5));
-                    double v = (j + utils::random_double(0, .5));
-                    double sx = get_emission_sx(u, v);
-                    double sy = get_emission_sy(u, v);
-
-                    vec3 direction_camera = vec3(sx, sy, -1);
-                    vec3 direction_world = (
-                        direction_camera.x() * g_right +
-                        direction_camera.y() * g_up +
-                        direction_camera.z() * g_forward
-                    ).unit_vector();
-
-                    vec3 ray_o = camera_pos;
-                    vec3 ray_d = direction_world;
-
-                    if (defocus_angle > 0) {
-                        vec3 focal_point = camera_pos + focus_dist * ray_d;
-                        auto rand_vec = random_in_unit_disk();
-                        ray_o += rand_vec.x() * (g_right * defocus_radius) + rand_vec.y() * (g_up * defocus_radius);
-                        ray_d = (focal_point - ray_o).unit_vector();
+                generate_rays_kernel<false, true>(t.x0, t.y0, t.x1, t.y1, 1, batch);
+            }
+
+            for (int k = 0; k < batch.size(); k++) {
+                int pixel = batch.pixel[k];
+                seed_random(sample_seed(pixel, rng_stream::path));
+                aov_sample a;
+                a.albedo = scene_color;
+                resampled[pixel] = restir.sample(pixel, batch.get(k), collect_aovs ? &a : nullptr);
+                if (!resampled[pixel]) {
+                    radiance[pixel] = ray_color(batch.get(k), world_list, 0);
+                }
+                if (collect_aovs) {
+                    accumulate_aov(pixel, a);
+                }
+            }
+        });
+
+        // Stage 2: spatial reuse and shading, plus one path for the indirect light, then accumulation
+        pool.parallel_for(static_cast<int>(tiles.size()), [&](int index, int) {
+            const auto& t = tiles[index];
+            for (int j = t.y0; j < t.y1; ++j) {
+                for (int i = t.x0; i < t.x1; ++i) {
+                    int pixel = j * image_width + i;
+                    if (resampled[pixel]) {
+                        seed_random(sample_seed(pixel, rng_stream::reuse));
+                        ray scattered(vec3(0, 0, 0), vec3(0, 0, 1));
+                        color attenuation;
+                        color c = restir.shade(pixel, scattered, attenuation);
+                        radiance[pixel] = c + hadamard(attenuation, ray_color(scattered, world_list, 1, nullptr, true));
                     }
 
-                    ray r(ray_o, ray_d);
-                    c += ray_color(r, world_list, 0);
+                    const color& c = radiance[pixel];
+                    Real lum = luminance(c);
+                    accum[static_cast<size_t>(pixel) * channels + 0] += static_cast<float>(c.x());
+                    accum[static_cast<size_t>(pixel) * channels + 1] += static_cast<float>(c.y());
+                    accum[static_cast<size_t>(pixel) * channels + 2] += static_cast<float>(c.z());
+                    accum_lum_sq[pixel] += static_cast<float>(lum * lum);
+                    pixel_spp[pixel] += 1;
                 }
-                c /= aa_factor;
             }
+            samples_traced += t.pixel_count();
+        });
+        restir.end_pass();
 
-            convert_to_255_scale(c);
-            int pixel_index = (j * image_width + i) * channels;
-            image[pixel_index + 0] = static_cast<unsigned char>(c.x());
-            image[pixel_index + 1] = static_cast<unsigned char>(c.y());
-            image[pixel_index + 2] = static_cast<unsigned char>(c.z());
+        resolve();
+        if (on_pass && !on_pass(p + 1, passes)) {
+            break;
         }
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    log_render(use_dof ? "resampled direct lighting + DOF" : "resampled direct lighting", elapsed);
+    std::clog << "ReSTIR: " << settings.candidates << " candidates per pixel and pass, "
+              << (settings.temporal ? "temporal" : "no temporal") << " reuse, "
+              << (settings.spatial ? std::to_string(settings.neighbours) + " spatial neighbours" : std::string("no spatial reuse")) << '\n';
+}
+
+void camera::render_adaptive(const world& w, const vec3& cam, const vec3& look, int min_spp, int batch_spp, Real noise_target,
+                             const std::function<bool()>& cancelled) {
+    begin_frame(w, cam, look);
+    stop_requested = cancelled;
+    min_spp = std::max(2, min_spp);
+    batch_spp = std::max(1, batch_spp);
+
+    // The AA-Factor is the average sample budget per pixel
+    auto tiles = frame_tiles();
+    const long long pixels = std::max(1LL, total_pixels(tiles));
+    const long long budget = std::max(static_cast<long long>(aa_factor), static_cast<long long>(min_spp)) * pixels;
+    long long spent = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    const char* kernel_name = render_tiles(tiles, min_spp, true);
+    spent += min_spp * pixels;
+
+    std::vector<Real> errors(tiles.size());
+    int rounds = 0;
+    while (spent < budget && !(cancelled && cancelled())) {
+        pool.parallel_for(static_cast<int>(tiles.size()), [&](int index, int) {
+            errors[index] = tile_error(tiles[index]);
+        });
 
-        std::clog << "\rScanlines remaining: " << (image_height - j) << ' ' << std::flush;
+        // Noisiest tiles first; only tiles above the target are refined
+        std::vector<int> ranked;
+        for (int t = 0; t < static_cast<int>(tiles.size()); t++) {
+            if (errors[t] > noise_target) {
+                ranked.push_back(t);
+            }
+        }
+        if (ranked.empty()) {
+            break;
+        }
+        std::sort(ranked.begin(), ranked.end(), [&](int a, int b) { return errors[a] > errors[b]; });
+
+        // Hand the next batch to the top quarter (at least one tile), bounded by the remaining budget
+        size_t take = std::max<size_t>(1, (ranked.size() + 3) / 4);
+        std::vector<tile> refine;
+        for (size_t r = 0; r < take && r < ranked.size(); r++) {
+            const auto& t = tiles[ranked[r]];
+            if (spent + static_cast<long long>(t.pixel_count()) * batch_spp > budget) {
+                break;
+            }
+            refine.push_back(t);
+            spent += static_cast<long long>(t.pixel_count()) * batch_spp;
+        }
+        if (refine.empty()) {
+            break;
+        }
+
+        render_tiles(refine, batch_spp, true);
+        rounds++;
     }
 
-    std::clog << "\rDone.                 \n";
+    stop_requested = nullptr;
+    resolve();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    log_render(kernel_name, elapsed);
+    std::clog << "Adaptive: " << rounds << " refinement rounds, " << spent << " / " << budget << " samples of budget used\n";
+}
+
+render_status camera::render(const world& w, const vec3& cam, const vec3& look, render_job& job) {
+    begin_frame(w, cam, look);
+    job.start();
+    active_job = &job;
+
+    auto tiles = frame_tiles();
+    const long long pixels = std::max(1LL, total_pixels(tiles));
+    const int target_spp = std::max(1, static_cast<int>(aa_factor));
+    const bool jitter = aa_factor != 1;
+
+    // Samples still allowed by the budget
+    auto budget_left = [&]() {
+        return job.sample_budget > 0 ? job.sample_budget - samples_traced : std::numeric_limits<long long>::max();
+    };
+    // Whether `samples` more samples fit the remaining time, going by the throughput measured so far
+    auto time_allows = [&](long long samples) {
+        double ms_per_sample = job.elapsed_ms() / std::max(1LL, samples_traced.load());
+        return samples * ms_per_sample <= job.remaining_ms();
+    };
+
+    // Preview: a complete, displayable frame before any limit applies
+    job_phase = render_phase::preview;
+    const char* kernel_name = render_tiles(tiles, 1, jitter);
+    int uniform_spp = 1;
+
+    // Uniform passes, doubling in size up to 16 spp, for as long as a whole pass fits the limits
+    render_status status = render_status::completed;
+    job_phase = render_phase::uniform;
+    while (uniform_spp < target_spp && !job.cancelled()) {
+        int spp = std::min({uniform_spp, 16, target_spp - uniform_spp});
+        if (spp * pixels > budget_left()) {
+            status = render_status::budget;
+            break;
+        }
+        if (!time_allows(spp * pixels)) {
+            status = render_status::deadline;
+            break;
+        }
+
+        // A pass cut short by the deadline still leaves valid per-pixel means behind
+        long long before = samples_traced;
+        render_tiles(tiles, spp, jitter);
+        if (samples_traced - before < spp * pixels) {
+            status = render_status::deadline;
+            break;
+        }
+        uniform_spp += spp;
+        resolve();
+    }
+
+    // Refinement: batches of 4 spp for the noisiest tiles, re-ranked every round, until nothing fits any more
+    job_phase = render_phase::refine;
+    const int batch_spp = 4;
+    while (status != render_status::completed && !job.cancelled() && !job.past_deadline()) {
+        auto ranked = rank_tiles(tiles);
+
+        std::vector<tile> refine;
+        long long cost = 0;
+        for (size_t r = 0; r < (ranked.size() + 3) / 4; r++) {
+            long long tile_cost = static_cast<long long>(tiles[ranked[r]].pixel_count()) * batch_spp;
+            if (cost + tile_cost > budget_left() || !time_allows(cost + tile_cost)) {
+                break;
+            }
+            refine.push_back(tiles[ranked[r]]);
+            cost += tile_cost;
+        }
+        if (refine.empty()) {
+            break;
+        }
+        render_tiles(refine, batch_spp, true);
+    }
+
+    resolve();
+    active_job = nullptr;
+
+    if (job.cancelled()) {
+        status = render_status::cancelled;
+    }
+
+    render_progress progress;
+    progress.phase          = job_phase;
+    progress.samples_done   = samples_traced;
+    progress.samples_target = target_spp * pixels;
+    progress.tiles_done     = static_cast<int>(tiles.size());
+    progress.tiles_total    = static_cast<int>(tiles.size());
+    progress.elapsed_ms     = job.elapsed_ms();
+    job.report(progress);
+
+    log_render(kernel_name, progress.elapsed_ms);
+    std::clog << "Job: " << status_name(status) << " after " << uniform_spp << " / " << target_spp << " uniform spp, "
+              << samples_traced << " samples traced\n";
+    return status;
+}
+
+void camera::export_tile(const tile& t, tile_samples& out) const {
+    const int channels = 3;
+    out.bounds = t;
+    out.rgb.clear();
+    out.lum_sq.clear();
+    out.spp.clear();
+    out.aov.clear();
+    for (int j = t.y0; j < t.y1; ++j) {
+        for (int i = t.x0; i < t.x1; ++i) {
+            int pixel = j * image_width + i;
+            out.rgb.insert(out.rgb.end(), &accum[static_cast<size_t>(pixel) * channels], &accum[static_cast<size_t>(pixel) * channels] + channels);
+            out.lum_sq.push_back(accum_lum_sq[pixel]);
+            out.spp.push_back(pixel_spp[pixel]);
+            if (accum_aov.size() != 0) {
+                const float* sums = &accum_aov[static_cast<size_t>(pixel) * aov_stride];
+                out.aov.insert(out.aov.end(), sums, sums + aov_stride);
+            }
+        }
+    }
+}
+
+void camera::import_tile(const tile_samples& in) {
+    const int channels = 3;
+    const auto& t = in.bounds;
+    // AOVs only merge into a frame that collects them, and only when the sender collected them too
+    const bool aovs = accum_aov.size() != 0 && in.aov.size() == in.spp.size() * aov_stride;
+    long long samples = 0;
+    int k = 0;
+    for (int j = t.y0; j < t.y1; ++j) {
+        for (int i = t.x0; i < t.x1; ++i, ++k) {
+            int pixel = j * image_width + i;
+            for (int c = 0; c < channels; c++) {
+                accum[static_cast<size_t>(pixel) * channels + c] += in.rgb[static_cast<size_t>(k) * channels + c];
+            }
+            accum_lum_sq[pixel] += in.lum_sq[k];
+            pixel_spp[pixel] += in.spp[k];
+            samples += in.spp[k];
+            if (aovs) {
+                float* sums = &accum_aov[static_cast<size_t>(pixel) * aov_stride];
+                for (int a = 0; a < aov_stride; a++) {
+                    sums[a] += in.aov[static_cast<size_t>(k) * aov_stride + a];
+                }
+            }
+        }
+    }
+    samples_traced += samples;
+}
+
+uint64_t camera::sample_seed(int pixel, rng_stream stream, int sample) const {
+    // Samples already taken by the pixel make every pass draw fresh numbers
+    uint64_t base = pixel_spp.empty() ? 0 : static_cast<uint64_t>(pixel_spp[pixel]);
+    return hash_seed(frame_seed, static_cast<uint64_t>(pixel), ((base + sample) << 2) | static_cast<uint64_t>(stream));
+}
+
+void camera::set_seed(uint64_t seed) {
+    frame_seed = seed;
+}
+
+void camera::set_progress_log(bool enabled) {
+    log_progress = enabled;
+}
+
+void camera::set_engine(render_engine engine_) {
+    engine = engine_;
+}
+
+void camera::set_light_sampling(bool enabled) {
+    sample_lights = enabled;
+}
+
+void camera::set_path_guiding(bool enabled, const guide_settings& settings) {
+    use_guiding = enabled;
+    guiding = settings;
+}
+
+void camera::set_caustics(bool enabled, const photon_settings& settings) {
+    use_caustics = enabled;
+    caustic_settings = settings;
+}
+
+void camera::set_material_sorting(bool enabled) {
+    sort_by_material = enabled;
+}
+
+void camera::set_display(framebuffer* display_) {
+    display = display_;
+}
+
+void camera::set_aovs(bool enabled) {
+    aovs_requested = enabled;
+    collect_aovs = aovs_requested || denoise_enabled;
+}
+
+bool camera::collects_aovs() const {
+    return collect_aovs;
+}
+
+void camera::set_denoising(bool enabled, const denoise_settings& settings) {
+    denoise_enabled = enabled;
+    denoiser = settings;
+    collect_aovs = aovs_requested || denoise_enabled;
+}
+
+void camera::set_tone_mapping(tone_operator op, float exposure_) {
+    tone_op = op;
+    exposure = std::max(0.0f, exposure_);
+}
+
+void camera::set_display_plane(aov plane) {
+    display_plane = plane;
+}
+
+const film& camera::get_film() const {
+    return hdr;
+}
+
+void camera::set_crop(int x0, int y0, int x1, int y1) {
+    crop = intersect({x0, y0, x1, y1}, {0, 0, image_width, image_height});
+    use_crop = true;
+}
+
+void camera::clear_crop() {
+    use_crop = false;
+}
+
+long long camera::render_pixel_count() const {
+    return total_pixels(frame_tiles());
+}
+
+tile camera::project_bounds(const AABB& box) const {
+    const tile full = {0, 0, image_width, image_height};
+    const vec3 lo = box.get_lo();
+    const vec3 hi = box.get_hi();
+    const Real du = pixel_delta_u.magnitude();
+    const Real dv = pixel_delta_v.magnitude();
+    const Real near_plane = 1e-3;
+
+    Real x_min = std::numeric_limits<Real>::infinity(), x_max = -x_min;
+    Real y_min = x_min, y_max = -x_min;
+    Real blur = 0;
+    for (int corner = 0; corner < 8; corner++) {
+        vec3 p((corner & 1) ? hi.x() : lo.x(), (corner & 2) ? hi.y() : lo.y(), (corner & 4) ? hi.z() : lo.z());
+        vec3 d = p - camera_pos;
+        Real z = -(d * g_forward);
+        if (z < near_plane) {
+            return full;
+        }
+
+        // Onto the unit-distance image plane, then into pixel coordinates measured from pixel00_dir
+        vec3 on_plane = d / z - pixel00_dir;
+        Real px = (on_plane * g_right) / du;
+        Real py = -(on_plane * g_up) / dv;
+        x_min = std::fmin(x_min, px); x_max = std::fmax(x_max, px);
+        y_min = std::fmin(y_min, py); y_max = std::fmax(y_max, py);
+
+        // Circle of confusion on the image plane: lens radius times the difference in inverse depth
+        if (config::enable_dof && defocus_angle > 0) {
+            blur = std::fmax(blur, defocus_radius * std::fabs(1 / z - 1 / focus_dist) / std::fmin(du, dv));
+        }
+    }
+
+    tile bounds = {static_cast<int>(std::floor(x_min - blur)) - 1, static_cast<int>(std::floor(y_min - blur)) - 1,
+                   static_cast<int>(std::ceil(x_max + blur)) + 1, static_cast<int>(std::ceil(y_max + blur)) + 1};
+    return intersect(bounds, full);
+}
+
+void camera::rerender(const world& w, const vec3& cam, const vec3& look, const std::vector<AABB>& edited, int margin,
+                      const std::function<bool()>& cancelled) {
+    // The frame must also have the buffers this render writes: AOV planes exist only when they were collected, and
+    // pixels outside the frame's crop were never rendered
+    const bool same_crop = use_crop == frame_use_crop && (!use_crop || (crop.x0 == frame_crop.x0 && crop.y0 == frame_crop.y0
+                                                                         && crop.x1 == frame_crop.x1 && crop.y1 == frame_crop.y1));
+    const bool same_view = has_frame && (cam - frame_cam).magnitude() == 0 && (look - frame_look).magnitude() == 0
+                           && static_cast<int>(pixel_spp.size()) == image_width * image_height
+                           && (accum_aov.size() != 0) == collect_aovs && same_crop;
+    if (!same_view) {
+        std::clog << "Re-render: no frame of this view, crop and AOV set, rendering in full\n";
+        stop_requested = cancelled;
+        render(w, cam, look);
+        stop_requested = nullptr;
+        return;
+    }
+
+    // Dirty regions: the projected bounds of every edited object, grown by the margin
+    std::vector<tile> dirty;
+    for (const auto& box : edited) {
+        auto r = project_bounds(box);
+        r = intersect({r.x0 - margin, r.y0 - margin, r.x1 + margin, r.y1 + margin}, {0, 0, image_width, image_height});
+        if (!r.empty()) {
+            dirty.push_back(r);
+        }
+    }
+
+    auto tiles = touched_tiles(frame_tiles(), dirty);
+    const long long dirty_pixels = total_pixels(tiles);
+    world_list = w;
+    lights.build(world_list);
+    bdpt_lights.build(world_list);
+    build_caustics();
+
+    auto start = std::chrono::steady_clock::now();
+    const char* kernel_name = "none";
+    stop_requested = cancelled;
+    if (dirty_pixels * 2 > frame_pixels) {
+        // Too much changed for region updates to pay off: a quick full frame
+        begin_frame(w, cam, look);
+        int spp = std::max(1, static_cast<int>(aa_factor) / 4);
+        kernel_name = render_pass(spp, aa_factor != 1);
+        std::clog << "Re-render: dirty region covers " << (100 * dirty_pixels / std::max(1LL, frame_pixels))
+                  << "% of the frame, full frame at " << spp << " spp\n";
+    } else if (!tiles.empty()) {
+        clear_tiles(tiles);
+        kernel_name = render_tiles(tiles, static_cast<int>(aa_factor), aa_factor != 1);
+        std::clog << "Re-render: " << tiles.size() << " dirty tiles, " << dirty_pixels << " of " << frame_pixels << " pixels\n";
+    }
+    stop_requested = nullptr;
+
+    resolve();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    log_render(kernel_name, elapsed);
+}
+
+void camera::set_tiling(int size, tile_order tile_order_) {
+    tile_size = std::max(1, size);
+    order = tile_order_;
+}
+
+const std::vector<tile_stats>& camera::get_tile_stats() const {
+    return tile_timings;
 }
 
 int camera::export_image(const std::vector<unsigned char>& image, int image_width, int image_height, int stride) {
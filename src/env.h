@@ -1,19 +1,55 @@
 #ifndef ENV_H
 #define ENV_H
 
-#include <omp.h>
 #include <thread>
 #include <atomic>
 #include <vector>
 #include <ctime>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include "util.h"
 #include "color.h"
 #include "objects/world.h"
+#include "sampling/warp.h"
+#include "fastmath.h"
+#include "render/thread_pool.h"
+#include "render/first_touch.h"
+#include "render/tiles.h"
+#include "render/wavefront.h"
+#include "render/render_job.h"
+#include "render/framebuffer.h"
+#include "render/film.h"
+#include "render/tonemap.h"
+#include "render/restir.h"
+#include "render/denoise.h"
+#include "render/photons.h"
+#include "render/bdpt.h"
+#include "sampling/lights.h"
+#include "sampling/guiding.h"
 #include "lib/stb_image_write.h"
 
 using std::tan;
 using namespace utils;
 
+// Accumulated sums of one tile, as exchanged by distributed rendering
+struct tile_samples {
+    tile                bounds;
+    std::vector<float>  rgb;        // Radiance sums, 3 per pixel
+    std::vector<float>  lum_sq;     // Sums of squared luminance
+    std::vector<int>    spp;        // Samples per pixel
+    std::vector<float>  aov;        // AOV sums, 8 per pixel (see camera::accum_aov); empty when they are not collected
+};
+
+// How paths are traced: one path at a time through ray_color, stage by stage over SoA queues, or one camera and
+// one light subpath at a time, connected by bidirectional path tracing (see bdpt.h)
+enum class render_engine {
+    megakernel,
+    wavefront,
+    bidirectional
+};
+
 // Hic sunt background stuffs
 class camera {
     private:
@@ -21,34 +57,290 @@ class camera {
         world   world_list;
         int     image_width       = 600;
         int     image_height      = 600;
-        double  focal_length;
-        double  viewport_width;
-        double  viewport_height;
-        double  fov               = 40;
-        double  defocus_angle     = 0.0;
-        double  focus_dist        = 10;
-        double  defocus_radius    = focus_dist * tan(deg_to_rad(defocus_angle/ 2));
-        const double aspect_ratio = (double (image_width)) / image_height;
+        Real    focal_length;
+        Real    viewport_width;
+        Real    viewport_height;
+        Real    fov               = 40;
+        Real    defocus_angle     = 0.0;
+        Real    focus_dist        = 10;
+        Real    defocus_radius    = focus_dist * tan(deg_to_rad(defocus_angle/ 2));
+        const Real   aspect_ratio = (Real (image_width)) / image_height;
 
         vec3    scene_color       = vec3(0.0, 0.0, 0.0);                                // Default background color
 
         // Number of rays shot per pixel
-        const double aa_factor    = 70;
+        const Real   aa_factor    = 70;
+
+        // Upper bound on path length; Russian roulette normally ends paths well before it
         const int    depth        = 10;
 
+        // Bounces before Russian roulette may terminate a path
+        const int    rr_start_depth = 3;
+
         vec3 camera_pos    = vec3(0, 0, 0);
         vec3 g_forward     = vec3(0, 0, -1);
         vec3 g_right       = vec3(1, 0, 0);
         vec3 g_up          = vec3(0, 1, 0);
 
-        double get_emission_sx(double x, double y);
-        double get_emission_sy(double x, double y);
+        // Ray generation basis, computed once in preprocess.
+        // The (unnormalized) direction through continuous pixel coordinate (px, py) is pixel00_dir + px * pixel_delta_u + py * pixel_delta_v.
+        vec3 pixel00_dir   = vec3(0, 0, -1);
+        vec3 pixel_delta_u = vec3(0, 0, 0);
+        vec3 pixel_delta_v = vec3(0, 0, 0);
+        vec3 defocus_u     = vec3(0, 0, 0);     // Lens disk axes scaled by the defocus radius
+        vec3 defocus_v     = vec3(0, 0, 0);
+
+        // Tile scheduling
+        thread_pool             pool;
+        int                     tile_size       = 32;
+        tile_order              order           = tile_order::morton;
+        std::vector<tile_stats> tile_timings;
+
+        // Region of interest: only pixels inside it are rendered (the whole image when not set)
+        bool                    use_crop        = false;
+        tile                    crop            = {0, 0, 0, 0};
+
+        // View of the frame held in the accumulation buffers, so rerender can tell whether it still applies
+        bool                    has_frame       = false;
+        vec3                    frame_cam       = vec3(0, 0, 0);
+        vec3                    frame_look      = vec3(0, 0, 0);
+        long long               frame_pixels    = 0;        // Pixels inside the crop
+        bool                    frame_use_crop  = false;    // Crop the frame was rendered with; pixels outside it hold nothing
+        tile                    frame_crop      = {0, 0, 0, 0};
+        render_engine           engine          = render_engine::megakernel;
+        bool                    sort_by_material = false;   // Off until a multi-core measurement shows a gain
+
+        // Emitters of the scene, for next event estimation at diffuse hits
+        light_list              lights;
+        // ... and where light subpaths of the bidirectional engine start
+        bdpt_emitters           bdpt_lights;
+        bool                    sample_lights   = true;
+
+        // Path guiding of progressive megakernel renders (see guiding.h). guide exists from the first pass of such a
+        // render until the next begin_frame; deposits are only made while guide_training is set.
+        bool                        use_guiding     = false;
+        guide_settings              guiding;
+        std::unique_ptr<path_guide> guide;
+        bool                        guide_training  = false;
+
+        // Samples the next direction at a hit from a mix of the guide's distribution for the leaf and the BSDF
+        bsdf_sample sample_guided(const ray& r, const hit_history& hist, int leaf) const;
+        // Density of that mix for direction wi, at a trained leaf
+        Real        guided_pdf(const hit_history& hist, int leaf, const vec3& wi) const;
+
+        // Caustic photon map, rebuilt by begin_frame while use_caustics is set (see photons.h)
+        bool                    use_caustics    = false;
+        photon_settings         caustic_settings;
+        photon_map              caustics;
+        double                  caustics_ms     = 0;        // Time the last build took
+
+        // Rebuilds (or clears) the photon map for world_list
+        void        build_caustics();
+
+        // Running radiance sums (RGB) of every sample taken since begin_frame, plus the per-pixel
+        // sum of squared luminance and sample count for variance estimates.
+        // begin_frame zeroes them through the pool, so each tile's pages are first touched on a node that renders it.
+        first_touch_array<float>    accum;
+        first_touch_array<float>    accum_lum_sq;
+        first_touch_array<int>      pixel_spp;
+
+        // Per-pixel AOV sums when collect_aovs is on: albedo (3), normal (3), depth over hits, hit count.
+        // They are collected when asked for and whenever the denoiser needs them.
+        bool                    collect_aovs    = false;
+        bool                    aovs_requested  = false;
+        bool                    denoise_enabled = false;
+        denoise_settings        denoiser;
+        double                  denoise_ms      = 0;        // Time the last resolve spent denoising
+        first_touch_array<float>    accum_aov;
+        static constexpr int    aov_stride      = 8;
+
+        // HDR render target written by resolve, and how develop turns it into the 8-bit image
+        film                    hdr;
+        tone_operator           tone_op         = tone_operator::clamp;
+        float                   exposure        = 1.0f;
+        aov                     display_plane   = aov::beauty;
+
+        // Random streams are seeded from (frame_seed, pixel, sample number, stream) so that the image is the same
+        // whichever thread or process renders a tile
+        enum class rng_stream { jitter, lens, path, reuse };
+        uint64_t                frame_seed      = 0;
+        uint64_t    sample_seed(int pixel, rng_stream stream, int sample = 0) const;
+
+        // Camera samples traced since begin_frame
+        std::atomic<long long>  samples_traced{0};
+
+        // Job of the running render(..., job) call, if any. The kernels stop taking tiles once it is cancelled
+        // or, outside the preview phase, past its deadline.
+        render_job*             active_job      = nullptr;
+        render_phase            job_phase       = render_phase::preview;
+        // Cancel check of the running render_adaptive or rerender call, if any; the kernels stop taking tiles once it
+        // returns true
+        std::function<bool()>   stop_requested;
+
+        // Print the "Tiles remaining" line while rendering without a job
+        bool                    log_progress    = true;
+
+        // Receives a copy of the image after every resolve, if set
+        framebuffer*            display         = nullptr;
+
+        // Pixel loop, instantiated per feature combination so that disabled features leave no branches behind.
+        // Without Jitter all samples go through the pixel center.
+        template <bool UseDOF, bool Jitter>
+        void render_kernel(const std::vector<tile>& tiles, int spp);
+
+        // Renders a tile in batches of at most max_batch_rays primary rays (bands of rows, then chunks of samples),
+        // so the rays and samples a worker holds stay small at any tile size and sample count
+        template <bool UseDOF, bool Jitter>
+        void render_tile(const tile& t, int spp);
+        template <bool UseDOF, bool Jitter>
+        void render_batch(const tile& t, int spp);
+        static constexpr int    max_batch_rays  = 1 << 16;
+
+        // render_tiles over the whole frame
+        const char* render_pass(int spp, bool jitter);
+
+        // Estimated relative error of the tile's pixel means
+        Real        tile_error(const tile& t) const;
+
+        // Tiles of the frame in scheduling order, clipped to the crop rectangle
+        std::vector<tile> frame_tiles() const;
+
+        // Adds the first hit of one sample to the pixel's AOV sums
+        void        accumulate_aov(int pixel, const aov_sample& a);
+
+        // Resets the accumulated samples of the pixels in the tiles
+        void        clear_tiles(const std::vector<tile>& tiles);
+
+        // Tiles sorted by decreasing estimated error
+        std::vector<int> rank_tiles(const std::vector<tile>& tiles);
+
+        template <bool UseDOF, bool Jitter>
+        void generate_rays_kernel(int x0, int y0, int x1, int y1, int spp, ray_batch& batch) const;
 
     public:
-        camera(int width, int height, std::vector<unsigned char>& image, double fov, double dof_angle, const vec3& default_color, double aa_factor, double max_depth);
+        camera(int width, int height, std::vector<unsigned char>& image, Real fov, Real dof_angle, const vec3& default_color, Real aa_factor, Real max_depth);
         void    render(const world& w, const vec3& cam_pos, const vec3& look_dir);
-        color   ray_color(const ray& r, objs &world_list, int depth_level) const;
+
+        // Renders up to `passes` passes of spp_per_pass samples each into a persistent float accumulation buffer.
+        // After every pass the image holds a displayable snapshot and on_pass(pass, passes) is called; returning false stops the render.
+        void    render_progressive(const world& w, const vec3& cam_pos, const vec3& look_dir, int passes, int spp_per_pass,
+                                   const std::function<bool(int, int)>& on_pass = nullptr);
+        // Renders towards aa_factor samples per pixel within the job's deadline and sample budget. A one sample preview
+        // always completes first; what is left after the last affordable full-frame pass goes to the noisiest tiles.
+        // The image holds the best estimate so far whenever the call returns, including after cancellation.
+        render_status render(const world& w, const vec3& cam_pos, const vec3& look_dir, render_job& job);
+        // Interactive preview for many-light scenes: `passes` passes of one sample per pixel whose direct light comes from
+        // reservoir resampling (see restir.h), reusing light samples across neighbouring pixels and earlier passes.
+        // Indirect light takes one megakernel path sample per pass, whatever the engine. Snapshots and on_pass work as in render_progressive.
+        void    render_restir(const world& w, const vec3& cam_pos, const vec3& look_dir, int passes,
+                              const std::function<bool(int, int)>& on_pass = nullptr, const restir_settings& settings = restir_settings());
+        // Radiance along r. If aov is given, it receives the first hit of the path.
+        // With direct_done, light reaching r's origin straight from an emitter is left out (it was estimated elsewhere).
+        color   ray_color(const ray& r, objs &world_list, int depth_level, aov_sample* aov = nullptr, bool direct_done = false) const;
+        // Adaptive sampling: min_spp samples everywhere, then batches of batch_spp samples go to the tiles with the highest
+        // estimated error until every tile is below noise_target or the budget of aa_factor samples per pixel (on average) is spent.
+        // cancelled, if given, is polled between tiles from the render workers; once it returns true the render stops and
+        // keeps the image so far (tiles the first pass did not reach stay empty).
+        void    render_adaptive(const world& w, const vec3& cam_pos, const vec3& look_dir, int min_spp, int batch_spp, Real noise_target,
+                                const std::function<bool()>& cancelled = nullptr);
+
         void    preprocess(vec3 cam_pos, vec3 cam_look_dir, vec3 cam_up);
+
+        // Emits spp primary rays per pixel for the tile [x0, x1) x [y0, y1) into an SoA batch, pixel by pixel.
+        // A single sample goes through the pixel center; more samples are jittered and use the lens when DOF is on.
+        void    generate_rays(int x0, int y0, int x1, int y1, int spp, ray_batch& batch) const;
+        // Building blocks of the render entry points, for schedulers outside the camera (e.g. the distributed coordinator).
+        // Sets up the camera basis and clears the accumulation buffer
+        void        begin_frame(const world& w, const vec3& cam_pos, const vec3& look_dir);
+
+        // Adds spp samples per pixel of the given tiles to the accumulation buffer. Returns the name of the kernel used.
+        const char* render_tiles(const std::vector<tile>& tiles, int spp, bool jitter);
+
+        // Writes the accumulated mean of every pixel (and the AOVs) to the HDR film, then develops it
+        void        resolve();
+
+        void        log_render(const char* kernel_name, double elapsed) const;
+
+        // Copies the accumulated sums of a tile out, or adds sums rendered elsewhere into the buffers.
+        // import_tile is safe to call while render_tiles works on other tiles.
+        void        export_tile(const tile& t, tile_samples& out) const;
+        void        import_tile(const tile_samples& in);
+
+        // Seed of the frame's random streams. Renders with equal seeds and settings give identical images.
+        void    set_seed(uint64_t seed);
+
+        // Turns the per-tile progress line off, e.g. when render_tiles is called once per tile by a scheduler
+        void    set_progress_log(bool enabled);
+
+        // Selects the path tracing engine, e.g. for A/B benchmarks
+        void    set_engine(render_engine engine_);
+        // Next event estimation with MIS (on by default). Off, light is only found by paths that hit it.
+        void    set_light_sampling(bool enabled);
+
+        // Path guiding for render_progressive with the megakernel engine: the first training_passes passes learn where
+        // indirect light comes from, and every later bounce at a diffuse surface samples a mix of that and the BSDF.
+        // Off by default: it costs about a third more time per sample, which only pays off in hard indirect lighting.
+        void    set_path_guiding(bool enabled, const guide_settings& settings = guide_settings());
+
+        // Caustics from a photon map: light reaching diffuse surfaces through mirrors and glass is estimated from photons
+        // traced before every render instead of being left to camera paths. Biased (blurred by the gather radius).
+        void    set_caustics(bool enabled, const photon_settings& settings = photon_settings());
+
+        // Wavefront only: shade hits in per-material bins instead of queue order. Off by default: on one core the bins
+        // have not paid off, even with ten materials and two textures in view (see README). Kept for A/B runs.
+        void    set_material_sorting(bool enabled);
+
+        // Framebuffer that every displayable snapshot is published to (nullptr for none). Lets another thread show
+        // the render while it runs.
+        void    set_display(framebuffer* display_);
+
+        // Collect the albedo, normal, depth and sample count planes from the next render on
+        void    set_aovs(bool enabled);
+        // Whether the next render collects them, asked for or for the denoiser
+        bool    collects_aovs() const;
+
+        // Denoise the beauty plane on every resolve, guided by the AOVs (collected for it from the next render on).
+        // The beauty plane of the film then holds the filtered image.
+        void    set_denoising(bool enabled, const denoise_settings& settings = denoise_settings());
+
+        // Tone mapping used by develop. Exposure scales the radiance before the curve.
+        void    set_tone_mapping(tone_operator op, float exposure_);
+
+        // Plane of the film that develop shows: beauty is tone mapped, the AOVs are scaled into [0, 1]
+        void    set_display_plane(aov plane);
+
+        // Turns the HDR film into the 8-bit image and publishes it to the display.
+        // Cheap enough to call again after changing the tone mapping or displayed plane, without re-rendering.
+        void    develop();
+
+        // HDR result of the last render
+        const film& get_film() const;
+
+        // Restricts rendering to the pixels [x0, x1) x [y0, y1); the rest of the image stays black
+        void    set_crop(int x0, int y0, int x1, int y1);
+        void    clear_crop();
+        // Pixels a render covers: the crop rectangle, or the whole image. The basis of render_job::sample_budget.
+        long long   render_pixel_count() const;
+
+        // Conservative pixel rectangle covered by the box on screen, including the depth of field blur.
+        // Boxes reaching behind the camera cover the whole image.
+        tile    project_bounds(const AABB& box) const;
+
+        // Incremental re-render after scene edits. edited holds the bounds of the changed objects, both before and
+        // after the edit. The tiles touched by their projections grown by margin pixels (to catch nearby shadows and
+        // reflections) are reset and rendered again at full spp; the rest of the last frame is kept. Indirect effects
+        // beyond the margin are not picked up. When the dirty region covers more than half the image the whole frame
+        // is re-rendered at a quarter of the spp instead, and without a frame of the same view this is a full render.
+        // cancelled works as in render_adaptive; dirty tiles not reached by then stay empty.
+        void    rerender(const world& w, const vec3& cam_pos, const vec3& look_dir, const std::vector<AABB>& edited, int margin,
+                         const std::function<bool()>& cancelled = nullptr);
+
+        // Tile size in pixels and the order tiles are scheduled in
+        void    set_tiling(int size, tile_order tile_order_);
+
+        // Per-tile timings of the last render, in scheduling order
+        const std::vector<tile_stats>& get_tile_stats() const;
+
         int     export_image(const std::vector<unsigned char>& image, int image_width, int image_height, int stride);
 }; 
 
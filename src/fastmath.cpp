@@ -0,0 +1,100 @@
+#include "fastmath.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    std::atomic<bool> fast_math_on{TRACEY_FAST_MATH != 0};
+
+    // Minimax polynomial for atan on [0, 1]
+    inline double atan_unit(double x) {
+        double x2 = x * x;
+        return x * (0.99997726 + x2 * (-0.33262347 + x2 * (0.19354346 + x2 * (-0.11643287 + x2 * (0.05265332 + x2 * -0.01172120)))));
+    }
+
+    // log2 from the IEEE-754 exponent field plus a short atanh series on the mantissa
+    inline double log2_approx(double x) {
+        uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        int e = static_cast<int>((bits >> 52) & 0x7ff) - 1023;
+        bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+        double m;
+        std::memcpy(&m, &bits, sizeof(m));
+
+        // Center the mantissa around 1 so the series converges quickly
+        bool high = m > M_SQRT2;
+        m = high ? m * 0.5 : m;
+        e = high ? e + 1 : e;
+
+        double t = (m - 1) / (m + 1);
+        double t2 = t * t;
+        // 2 * atanh(t) / ln 2
+        double ln = 2 * t * (1 + t2 * (1.0 / 3 + t2 * (1.0 / 5)));
+        return e + ln * M_LOG2E;
+    }
+
+    // exp2 through integer split and a degree-5 Taylor expansion of e^(f ln 2) on [-0.5, 0.5]
+    inline double exp2_approx(double x) {
+        x = std::fmin(std::fmax(x, -1022.0), 1023.0);
+        double n = std::floor(x + 0.5);
+        double f = (x - n) * M_LN2;
+        double p = 1 + f * (1 + f * (1.0 / 2 + f * (1.0 / 6 + f * (1.0 / 24 + f * (1.0 / 120)))));
+
+        uint64_t bits = static_cast<uint64_t>(static_cast<int64_t>(n) + 1023) << 52;
+        double scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        return p * scale;
+    }
+}
+
+void fastmath::set_enabled(bool on) {
+    fast_math_on.store(on, std::memory_order_relaxed);
+}
+
+bool fastmath::enabled() {
+    return fast_math_on.load(std::memory_order_relaxed);
+}
+
+Real fastmath::approx_atan2(Real y, Real x) {
+    double ax = std::fabs(x);
+    double ay = std::fabs(y);
+    double hi = std::fmax(ax, ay);
+    double lo = std::fmin(ax, ay);
+    if (hi == 0) {
+        return 0;
+    }
+
+    double a = atan_unit(lo / hi);
+    if (ay > ax) {
+        a = M_PI_2 - a;
+    }
+    if (x < 0) {
+        a = M_PI - a;
+    }
+    return static_cast<Real>(std::copysign(a, y));
+}
+
+Real fastmath::approx_acos(Real x) {
+    double ax = std::fmin(std::fabs(static_cast<double>(x)), 1.0);
+    double r = std::sqrt(1 - ax) * (1.5707288 + ax * (-0.2121144 + ax * (0.0742610 + ax * -0.0187293)));
+    return static_cast<Real>(x < 0 ? M_PI - r : r);
+}
+
+Real fastmath::approx_tan(Real x) {
+    // Reduce to [-pi/4, pi/4] with tan(x) = 1 / tan(pi/2 - x), then use the (7, 6) Pade approximant
+    double ax = std::fabs(static_cast<double>(x));
+    bool reflect = ax > M_PI_4;
+    double r = reflect ? M_PI_2 - ax : ax;
+    double r2 = r * r;
+    double num = r * (135135 + r2 * (-17325 + r2 * (378 - r2)));
+    double den = 135135 + r2 * (-62370 + r2 * (3150 - 28 * r2));
+    double t = reflect ? den / num : num / den;
+    return static_cast<Real>(std::copysign(t, static_cast<double>(x)));
+}
+
+Real fastmath::approx_pow(Real x, Real y) {
+    if (x <= 0) {
+        return x == 0 ? 0 : std::pow(x, y);
+    }
+    return static_cast<Real>(exp2_approx(y * log2_approx(x)));
+}
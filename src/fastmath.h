@@ -0,0 +1,49 @@
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <cmath>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include "config.h"
+
+/*
+    Opt-in approximate transcendentals for the shading path.
+    Build with -DTRACEY_FAST_MATH=1 to enable them by default, or toggle at run time with
+    fastmath::set_enabled(). When disabled every function forwards to <cmath>.
+
+    Error bounds (measured against <cmath> in double precision):
+        atan2           |abs err| <= 2.0e-6 rad
+        acos            |abs err| <= 6.8e-5 rad     (Abramowitz & Stegun 4.4.45)
+        tan             |rel err| <= 1.0e-12        for |x| < pi/2 - 1e-3
+        pow             |rel err| <= 1.0e-5         for x in (0, 1e6], |y| <= 4
+        pow(x, 1/2.4)   |abs err| <= 3.0e-6         on [0, 1], far below one 8-bit step (3.9e-3)
+*/
+
+#ifndef TRACEY_FAST_MATH
+#define TRACEY_FAST_MATH 0
+#endif
+
+namespace fastmath {
+    // Runtime switch for the approximations
+    void set_enabled(bool on);
+    bool enabled();
+
+    Real approx_atan2(Real y, Real x);
+    Real approx_acos(Real x);
+    Real approx_tan(Real x);
+    Real approx_pow(Real x, Real y);
+
+    // Dispatching wrappers used by the shading code
+    inline Real atan2(Real y, Real x) { return enabled() ? approx_atan2(y, x) : std::atan2(y, x); }
+    inline Real acos(Real x)          { return enabled() ? approx_acos(x) : std::acos(x); }
+    inline Real tan(Real x)           { return enabled() ? approx_tan(x) : std::tan(x); }
+    inline Real pow(Real x, Real y)   { return enabled() ? approx_pow(x, y) : std::pow(x, y); }
+
+    // x^5 by repeated multiplication; exact up to rounding, used regardless of the switch
+    inline Real pow5(Real x) {
+        Real x2 = x * x;
+        return x2 * x2 * x;
+    }
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 Bulb::Bulb(const vec3& alb) : material(alb) {
     emissive = true;
+    type = material_type::bulb;
 }
 
 vec3 Bulb::emit(const vec3& point) const {
@@ -9,9 +10,8 @@ vec3 Bulb::emit(const vec3& point) const {
     return albedo;
 }
 
-tuple<vec3, ray> Bulb::scatter(const ray &r, const vec3& normal, const vec3& intersection, bool front, double u, double v) const {
-    auto secondary_dir = vec3(-1, -1, -1);                      // Sentinel value
-    auto secondary_ray = ray(intersection, secondary_dir);
-
-    return make_tuple(albedo, secondary_ray);
+bsdf_sample Bulb::sample(const ray &r, const vec3& normal, const vec3& intersection, bool front, Real u, Real v) const {
+    bsdf_sample s;
+    s.scattered = ray(intersection, vec3(-1, -1, -1));          // Sentinel value
+    return s;
 }
\ No newline at end of file
@@ -3,11 +3,12 @@
 
 #include "material.h"
 
-class Bulb : public material {
+class Bulb final : public material {
     public:
         Bulb(const vec3& alb);
         vec3 emit(const vec3& point) const override;
-        tuple<vec3, ray> scatter(const ray &r, const vec3& normal, const vec3& intersection, bool front, double u, double v) const override;
+        // Lights absorb: paths end at emitters, so the sample carries no weight
+        bsdf_sample sample(const ray &r, const vec3& normal, const vec3& intersection, bool front, Real u, Real v) const override;
 };
 
 #endif
\ No newline at end of file
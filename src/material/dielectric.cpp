@@ -1,17 +1,20 @@
 #include "dielectric.h"
 
-dielectric::dielectric(double refract_index) : ior(refract_index) {}
+dielectric::dielectric(Real refract_index) : ior(refract_index) {
+    type = material_type::dielectric;
+}
 
-tuple<vec3, ray> dielectric::scatter(const ray &r, const vec3& normal, const vec3& intersection, bool front, double u, double v) const {
+bsdf_sample dielectric::sample(const ray &r, const vec3& normal, const vec3& intersection, bool front, Real u, Real v) const {
     auto unit_normal = normal.unit_vector();
     auto d = r.get_direction().unit_vector();
-    double refraction = ior;
+    Real refraction = ior;
     if (front) {
         refraction = 1 / refraction;
     } 
 
-    auto k = 1.0 - pow(refraction, 2) * (1.0 - pow((unit_normal * d), 2));
-    double cos_theta = fmin((-1 *d) * normal, 1.0);
+    auto cos_i = unit_normal * d;
+    auto k = 1.0 - refraction * refraction * (1.0 - cos_i * cos_i);
+    Real cos_theta = fmin((-1 *d) * normal, 1.0);
     
     vec3 secondary_dir;
     if (k < 0 || schlick(refraction, unit_normal, d) > utils::random_double(0, 1)) {
@@ -20,15 +23,25 @@ tuple<vec3, ray> dielectric::scatter(const ray &r, const vec3& normal, const vec
         secondary_dir = d * refraction - unit_normal * (refraction * (unit_normal * d) + sqrt(k));
     }
 
-    return make_tuple(vec3(1.0, 1.0, 1.0), ray(intersection, secondary_dir));
+    // Reflection and refraction are picked in proportion to their Fresnel weights, which cancel out
+    bsdf_sample s;
+    s.scattered = ray(intersection, secondary_dir);
+    s.weight = vec3(1.0, 1.0, 1.0);
+    s.specular = true;
+    return s;
 }
 
-double dielectric::schlick(double ref, vec3 normal, vec3 vec) const {
+Real dielectric::schlick(Real ref, vec3 normal, vec3 vec) const {
     auto cos = (-1 * vec) * normal;
     if (cos > 1.0) {
         cos = 1.0;
     }
 
-    auto f0 = pow(ref - 1, 2) / pow(ref + 1, 2);
-    return f0 + (1 - f0) * pow((1 - cos), 5);
+    auto r0 = (ref - 1) / (ref + 1);
+    auto f0 = r0 * r0;
+    return f0 + (1 - f0) * fastmath::pow5(1 - cos);
+}
+
+vec3 dielectric::get_albedo(Real u, Real v, const vec3& point) const {
+    return vec3(1, 1, 1);
 }
\ No newline at end of file
@@ -2,19 +2,23 @@
 #define DIELECTRIC_H
 
 #include "material.h"
+#include "../fastmath.h"
 
-class dielectric : public material {
+class dielectric final : public material {
     private:
-        double ior;
+        Real ior;
 
         // Performs a Schlick approximation using unit normal and incident vectors.
-        double schlick(double ref, vec3 normal, vec3 vec) const;
+        Real schlick(Real ref, vec3 normal, vec3 vec) const;
 
     public:
-        dielectric(double refract_index);
+        dielectric(Real refract_index);
 
         // Calculates the refracted ray using Snell's law. May return total internal reflection.
-        tuple<vec3, ray> scatter(const ray &r, const vec3& normal, const vec3& intersection, bool front, double u, double v) const override;
+        bsdf_sample sample(const ray &r, const vec3& normal, const vec3& intersection, bool front, Real u, Real v) const override;
+
+        // Clear glass: white
+        vec3 get_albedo(Real u, Real v, const vec3& point) const override;
 };
 
 #endif
\ No newline at end of file
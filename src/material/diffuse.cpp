@@ -1,17 +1,40 @@
 #include "diffuse.h"
 
-diffuse::diffuse(const vec3& alb) : material(alb) {}
-diffuse::diffuse(shared_ptr<Texture> tex) : texture(tex), use_textures(true) {}
+diffuse::diffuse(const vec3& alb) : material(alb) {
+    density = true;
+}
+diffuse::diffuse(shared_ptr<Texture> tex) : texture(tex), use_textures(true) {
+    type = material_type::textured;
+    density = true;
+}
 
-tuple<vec3, ray> diffuse::scatter(const ray &r, const vec3& normal, const vec3& intersection, bool front, double u, double v) const {
-    auto secondary_dir = random_vector(1) + normal;
-    auto secondary_ray = ray(intersection, secondary_dir);
+bsdf_sample diffuse::sample(const ray &r, const vec3& normal, const vec3& intersection, bool front, Real u, Real v) const {
+    // Cosine-weighted hemisphere around the normal (same Lambertian distribution as unit sphere + normal)
+    auto frame = warp::onb(normal);
+    auto secondary_dir = frame.to_world(warp::square_to_cosine_hemisphere(utils::random_double(0, 1), utils::random_double(0, 1)));
 
-    if (use_textures) {
-        return make_tuple(texture->get_color_at(u, v, intersection), secondary_ray);
-    } else {
-        return make_tuple(albedo, secondary_ray);
+    bsdf_sample s;
+    s.scattered = ray(intersection, secondary_dir);
+    s.weight = get_albedo(u, v, intersection);
+    s.pdf = pdf(secondary_dir, normal);
+    return s;
+}
+
+vec3 diffuse::eval(const vec3& wi, const vec3& normal, Real u, Real v, const vec3& point) const {
+    Real cos_theta = wi * normal;
+    if (cos_theta <= 0) {
+        return vec3(0, 0, 0);
     }
+    return get_albedo(u, v, point) * (cos_theta / M_PI);
+}
+
+Real diffuse::pdf(const vec3& wi, const vec3& normal) const {
+    return warp::cosine_hemisphere_pdf(wi * normal);
+}
 
-    // return make_tuple(albedo, secondary_ray);
+vec3 diffuse::get_albedo(Real u, Real v, const vec3& point) const {
+    if (config::enable_textures && use_textures) {
+        return texture->get_color_at(u, v, point);
+    }
+    return albedo;
 }
\ No newline at end of file
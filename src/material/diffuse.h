@@ -4,10 +4,11 @@
 #include <memory>
 #include "material.h"
 #include "../texture/texture.h"
+#include "../sampling/warp.h"
 
 using std::shared_ptr;
 
-class diffuse : public material {
+class diffuse final : public material {
     public:
         // Diffuse surface
         diffuse(const vec3& alb);
@@ -15,8 +16,14 @@ class diffuse : public material {
         // Texture surface
         diffuse(shared_ptr<Texture> tex);
 
-        // Format: tuple<attenuation, resulting secondary ray>
-        tuple<vec3, ray> scatter(const ray &r, const vec3& normal, const vec3& intersection, bool front, double u, double v) const override;
+        // Cosine-weighted hemisphere around the normal: eval / pdf is the albedo
+        bsdf_sample sample(const ray &r, const vec3& normal, const vec3& intersection, bool front, Real u, Real v) const override;
+
+        // Lambertian: albedo / pi times the cosine, sampled with density cosine / pi
+        vec3 eval(const vec3& wi, const vec3& normal, Real u, Real v, const vec3& point) const override;
+        Real pdf(const vec3& wi, const vec3& normal) const override;
+
+        vec3 get_albedo(Real u, Real v, const vec3& point) const override;
 
     private:
         bool use_textures = false;
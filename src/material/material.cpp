@@ -7,6 +7,26 @@ vec3 material::emit(const vec3& point) const {
     return vec3(0,0,0);
 }
 
+vec3 material::eval(const vec3& wi, const vec3& normal, Real u, Real v, const vec3& point) const {
+    return vec3(0, 0, 0);
+}
+
+Real material::pdf(const vec3& wi, const vec3& normal) const {
+    return 0;
+}
+
+bool material::has_density() const {
+    return density;
+}
+
+vec3 material::get_albedo(Real u, Real v, const vec3& point) const {
+    return albedo;
+}
+
 bool material::is_emissive() const {
     return emissive;
+}
+
+material_type material::get_type() const {
+    return type;
 }
\ No newline at end of file
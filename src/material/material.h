@@ -1,15 +1,32 @@
 #ifndef MATERIAL_H
 #define MATERIAL_H
 
-#include <tuple>
 #include "../ray.h"
 
-using std::tuple, std::make_tuple;
+// Concrete material kinds, used to bin hits for specialized (non-virtual) shading kernels
+enum class material_type {
+    diffuse,
+    textured,
+    metal,
+    dielectric,
+    bulb,
+    count
+};
+
+// Outcome of sampling a material at a hit
+struct bsdf_sample {
+    ray     scattered   = ray(vec3(0, 0, 0), vec3(0, 0, 1));
+    vec3    weight      = vec3(0, 0, 0);    // BSDF times cosine over pdf: what the path throughput is multiplied by
+    Real    pdf         = 0;                // Solid-angle density of the direction; 0 when there is none (see specular)
+    bool    specular    = false;            // Delta lobe (mirror, glass): eval and pdf are zero for every direction
+};
 
 class material{
     protected:
         vec3 albedo;
         bool emissive = false;
+        bool density = false;
+        material_type type = material_type::diffuse;
 
     public:
         material() = default;
@@ -19,11 +36,27 @@ class material{
         // Returns the illumination created from the designated point
         virtual vec3 emit(const vec3& point) const;
 
-        // tuple<attenuation, resulting secondary ray>
-        virtual tuple<vec3, ray> scatter(const ray &r, const vec3& normal, const vec3& intersection, bool front, double u, double v) const = 0;
+        // Samples the direction a path continues in after arriving along r at a hit with the given normal
+        virtual bsdf_sample sample(const ray &r, const vec3& normal, const vec3& intersection, bool front, Real u, Real v) const = 0;
+
+        // BSDF times the cosine at the surface for light arriving along wi (pointing away from the surface), at a hit with the
+        // given normal. Zero for materials whose sample is a delta distribution or has no closed-form density (the default).
+        virtual vec3 eval(const vec3& wi, const vec3& normal, Real u, Real v, const vec3& point) const;
+
+        // Solid-angle density with which sample picks wi
+        virtual Real pdf(const vec3& wi, const vec3& normal) const;
+
+        // True when eval and pdf are implemented, so that light sampling can connect to hits on the material
+        bool has_density() const;
+
+        // Surface color at a hit, for the albedo AOV
+        virtual vec3 get_albedo(Real u, Real v, const vec3& point) const;
 
         // Check if the material is emissive
         bool is_emissive() const;
+
+        // Concrete kind of the material
+        material_type get_type() const;
 };
 
 #endif
\ No newline at end of file
@@ -1,14 +1,22 @@
 #include "metal.h"
 
-metal::metal(const vec3& alb) : material(alb) {}
+metal::metal(const vec3& alb) : material(alb) {
+    type = material_type::metal;
+}
 
-metal::metal(const vec3& alb, double fuzz) : material(alb), fuzziness(fuzz) {}
+metal::metal(const vec3& alb, Real fuzz) : material(alb), fuzziness(fuzz) {
+    type = material_type::metal;
+}
 
-tuple<vec3, ray> metal::scatter(const ray &r, const vec3& normal, const vec3& intersection, bool front, double u, double v) const {
+bsdf_sample metal::sample(const ray &r, const vec3& normal, const vec3& intersection, bool front, Real u, Real v) const {
     // https://inhopp.github.io/graphics/graphics9/ -- Reflection formula
     auto d = r.get_direction();
     auto secondary_dir = d - normal * (normal * d) * 2
     + (random_vector(1)) * fuzziness;
-    auto secondary_ray = ray(intersection, secondary_dir);
-    return make_tuple(albedo, secondary_ray);
+
+    bsdf_sample s;
+    s.scattered = ray(intersection, secondary_dir);
+    s.weight = albedo;
+    s.specular = true;
+    return s;
 }
\ No newline at end of file
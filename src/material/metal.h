@@ -3,14 +3,15 @@
 
 #include "material.h"
 
-class metal : public material {
+class metal final : public material {
     private:
         // Note: ranges from 0 to 1. 
-        double fuzziness = 0;
+        Real fuzziness = 0;
     public:
         metal(const vec3& alb);
-        metal(const vec3& alb, double fuzz);
-        tuple<vec3, ray> scatter(const ray &r, const vec3& normal, const vec3& intersection, bool front, double u, double v) const override;
+        metal(const vec3& alb, Real fuzz);
+        // Mirror reflection, perturbed by the fuzziness. Treated as specular: the fuzzed lobe has no closed-form density.
+        bsdf_sample sample(const ray &r, const vec3& normal, const vec3& intersection, bool front, Real u, Real v) const override;
 };
 
 #endif
\ No newline at end of file
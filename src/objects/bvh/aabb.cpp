@@ -1,7 +1,7 @@
 #include "aabb.h"
 AABB::AABB() {
-    auto lo_val = std::numeric_limits<double>::infinity();
-    auto hi_val = -std::numeric_limits<double>::infinity();
+    auto lo_val = std::numeric_limits<Real>::infinity();
+    auto hi_val = -std::numeric_limits<Real>::infinity();
 
     lo = vec3(lo_val, lo_val, lo_val);
     hi = vec3(hi_val, hi_val, hi_val);
@@ -15,7 +15,7 @@ AABB::AABB(const AABB& ab0, const AABB& ab1) {
     auto lo1 = ab1.get_lo();
     auto hi1 = ab1.get_hi();
 
-    double lx, ly, lz, hx, hy, hz;
+    Real lx, ly, lz, hx, hy, hz;
 
     lx = lo0.x() < lo1.x() ? lo0.x() : lo1.x();
     ly = lo0.y() < lo1.y() ? lo0.y() : lo1.y();
@@ -36,61 +36,51 @@ vec3 AABB::get_hi() const {
     return hi;
 }
 
-bool AABB::ray_hit(const ray& r, double t_lo, double t_hi) {
-    // Check ray-box intersection using the slab method for AABB
-    auto ray_dir = r.get_direction();
-    auto x_dir   = ray_dir.x();
-    auto y_dir   = ray_dir.y();
-    auto z_dir   = ray_dir.z();
-
-    auto lo_shift = lo - r.get_origin();
-    auto hi_shift = hi - r.get_origin();
-
-    auto t_min = t_lo;
-    auto t_max = t_hi;
-
-    // Check x-intersection
-    if (std::abs(ray_dir.x()) < 1e-8) {
-        if (r.get_origin().x() < lo.x() || r.get_origin().x() > hi.x()) {
-            return false;
-        }
-    }
-    auto x0 = lo_shift.x() / x_dir;
-    auto x1 = hi_shift.x() / x_dir;
-    t_min = std::max(t_min, std::min(x0, x1));
-    t_max = std::min(t_max, std::max(x0, x1));
-    if (t_min >= t_max) {
-        return false;
+namespace {
+    // Selects that return the second operand when the comparison involves NaN, matching minpd/maxpd.
+    // The running interval is always passed second, so a NaN plane distance (origin on a slab plane with a
+    // zero direction component: 0 * inf) leaves the interval untouched, counting the plane as inside the box.
+    inline Real min_keep(Real a, Real b) { return a < b ? a : b; }
+    inline Real max_keep(Real a, Real b) { return a > b ? a : b; }
+
+    // Conservative rounding: widen t_far by 2 * gamma(3) so that boxes grazed by the ray are not
+    // missed because of rounding in the subtract-multiply (Ize, "Robust BVH Ray Traversal").
+    constexpr Real half_eps  = std::numeric_limits<Real>::epsilon() * 0.5;
+    constexpr Real gamma3    = (3 * half_eps) / (1 - 3 * half_eps);
+    constexpr Real far_scale = 1 + 2 * gamma3;
+
+    // The near and far plane of each slab are picked by the sign of the inverse direction (Williams et al., "An
+    // Efficient and Robust Ray-Box Intersection Algorithm") rather than by a min/max of the two distances, which
+    // would turn a NaN on one plane into the other plane's infinity. Zero components have an infinite inverse
+    // carrying the zero's sign, so +0 and -0 rays lying in either plane all hit.
+    inline bool slab_test(const vec3& lo, const vec3& hi, const vec3& o, const vec3& inv, Real t_lo, Real t_hi) {
+        Real tx_near = ((inv.x() < 0 ? hi.x() : lo.x()) - o.x()) * inv.x();
+        Real tx_far  = ((inv.x() < 0 ? lo.x() : hi.x()) - o.x()) * inv.x();
+        Real ty_near = ((inv.y() < 0 ? hi.y() : lo.y()) - o.y()) * inv.y();
+        Real ty_far  = ((inv.y() < 0 ? lo.y() : hi.y()) - o.y()) * inv.y();
+        Real tz_near = ((inv.z() < 0 ? hi.z() : lo.z()) - o.z()) * inv.z();
+        Real tz_far  = ((inv.z() < 0 ? lo.z() : hi.z()) - o.z()) * inv.z();
+
+        Real t_near = max_keep(tx_near, t_lo);
+        Real t_far  = min_keep(tx_far, t_hi);
+        t_near = max_keep(ty_near, t_near);
+        t_far  = min_keep(ty_far, t_far);
+        t_near = max_keep(tz_near, t_near);
+        t_far  = min_keep(tz_far, t_far);
+
+        return t_near <= t_far * far_scale;
     }
+}
 
-    // Check y-intersection
-    if (std::abs(ray_dir.y()) < 1e-8) {
-        if (r.get_origin().y() < lo.y() || r.get_origin().y() > hi.y()) {
-            return false;
-        }
-    }
-    auto y0 = lo_shift.y() / y_dir;
-    auto y1 = hi_shift.y() / y_dir;
-    t_min = std::max(t_min, std::min(y0, y1));
-    t_max = std::min(t_max, std::max(y0, y1));
-    if (t_min >= t_max) {
-        return false;
-    }
+bool AABB::ray_hit(const ray& r, Real t_lo, Real t_hi) const {
+    // Branch-free slab method using the ray's precomputed inverse direction
+    return slab_test(lo, hi, r.get_origin(), r.get_inv_direction(), t_lo, t_hi);
+}
 
-    // Check z-intersection
-    if (std::abs(ray_dir.z()) < 1e-8) {
-        if (r.get_origin().z() < lo.z() || r.get_origin().z() > hi.z()) {
-            return false;
-        }
-    }
-    auto z0 = lo_shift.z() / z_dir;
-    auto z1 = hi_shift.z() / z_dir;
-    t_min = std::max(t_min, std::min(z0, z1));
-    t_max = std::min(t_max, std::max(z0, z1));
-    if (t_min >= t_max) {
-        return false;
+void AABB::ray_hit_n(const AABB* boxes, int n, const ray& r, Real t_lo, Real t_hi, bool* hits) {
+    const vec3 o   = r.get_origin();
+    const vec3 inv = r.get_inv_direction();
+    for (int i = 0; i < n; i++) {
+        hits[i] = slab_test(boxes[i].lo, boxes[i].hi, o, inv, t_lo, t_hi);
     }
-
-    return true;
 }
-
@@ -8,6 +8,7 @@
 #include "../../vec3.h"
 #include "../../ray.h"
 #include <memory>
+#include <limits>
 
 using std::make_shared, std::shared_ptr;
 
@@ -21,7 +22,10 @@ class AABB {
         vec3 get_lo() const;
         vec3 get_hi() const;
 
-        bool ray_hit(const ray& r, double t_lo, double t_hi);
+        bool ray_hit(const ray& r, Real t_lo, Real t_hi) const;
+
+        // Tests one ray against n boxes, writing one result per box into hits
+        static void ray_hit_n(const AABB* boxes, int n, const ray& r, Real t_lo, Real t_hi, bool* hits);
 
     private:
         // Bounding range
@@ -48,17 +48,43 @@ BoundingVolumeNode::BoundingVolumeNode(vector<shared_ptr<objs>>& objects, int lo
         }
     }
 
-    aabb = AABB(lchild->bounding_volume(), rchild->bounding_volume());
+    lnode = dynamic_cast<BoundingVolumeNode*>(lchild.get());
+    rnode = dynamic_cast<BoundingVolumeNode*>(rchild.get());
+    refit();
 }
 
-bool BoundingVolumeNode::ray_hit(const ray& r, double t_lo, double t_hi, hit_history &hist) {
+void BoundingVolumeNode::refit() {
+    child_aabb[0] = lchild->bounding_volume();
+    child_aabb[1] = rchild->bounding_volume();
+    aabb = AABB(child_aabb[0], child_aabb[1]);
+}
+
+bool BoundingVolumeNode::ray_hit(const ray& r, Real t_lo, Real t_hi, hit_history &hist) {
     if (!aabb.ray_hit(r, t_lo, t_hi)) {
         return false;
     }
 
-    bool hit_left = lchild->ray_hit(r, t_lo, t_hi, hist);
-    bool hit_right = rchild->ray_hit(r, t_lo, hit_left ? hist.t : t_hi, hist);
-    
+    return traverse(r, t_lo, t_hi, hist);
+}
+
+bool BoundingVolumeNode::traverse(const ray& r, Real t_lo, Real t_hi, hit_history &hist) {
+    bool box_hit[2];
+    AABB::ray_hit_n(child_aabb, 2, r, t_lo, t_hi, box_hit);
+
+    bool hit_left = false;
+    if (box_hit[0]) {
+        hit_left = lnode ? lnode->traverse(r, t_lo, t_hi, hist)
+                         : lchild->ray_hit(r, t_lo, t_hi, hist);
+    }
+
+    // Single-object leaves store the same object twice
+    bool hit_right = false;
+    if (box_hit[1] && rchild != lchild) {
+        auto t_max = hit_left ? hist.t : t_hi;
+        hit_right = rnode ? rnode->traverse(r, t_lo, t_max, hist)
+                          : rchild->ray_hit(r, t_lo, t_max, hist);
+    }
+
     return hit_left || hit_right;
 }
 
@@ -71,21 +97,29 @@ void BoundingVolumeNode::translate(const vec3& offset) {
         lchild->translate(offset);
     }
 
-    if (rchild != nullptr) {
+    if (rchild != nullptr && rchild != lchild) {
         rchild->translate(offset);
     }
 
-    aabb = AABB(lchild->bounding_volume(), rchild->bounding_volume());
+    refit();
 }
 
-void BoundingVolumeNode::rotate(double theta, char axis) {
+void BoundingVolumeNode::rotate(Real theta, char axis) {
     if (lchild != nullptr) {
         lchild->rotate(theta, axis);
     }
 
-    if (rchild != nullptr) {
+    if (rchild != nullptr && rchild != lchild) {
         rchild->rotate(theta, axis);
     }
 
-    aabb = AABB(lchild->bounding_volume(), rchild->bounding_volume());
+    refit();
+}
+
+void BoundingVolumeNode::collect_emitters(std::vector<const objs*>& emitters) const {
+    // Single-object leaves hold the object in both children
+    lchild->collect_emitters(emitters);
+    if (rchild != lchild) {
+        rchild->collect_emitters(emitters);
+    }
 }
\ No newline at end of file
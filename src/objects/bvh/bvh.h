@@ -12,15 +12,27 @@ class BoundingVolumeNode : public objs {
         BoundingVolumeNode(world& w);
         BoundingVolumeNode(vector<shared_ptr<objs>>& objects, int lo, int hi);
 
-        bool ray_hit(const ray& r, double t_lo, double t_hi, hit_history &hist) override;
+        bool ray_hit(const ray& r, Real t_lo, Real t_hi, hit_history &hist) override;
         AABB bounding_volume() const override;
         void translate(const vec3& offset) override;
-        void rotate(double theta, char axis) override;
+        void rotate(Real theta, char axis) override;
+        void collect_emitters(std::vector<const objs*>& emitters) const override;
 
     private:
         shared_ptr<objs> lchild = nullptr;
         shared_ptr<objs> rchild = nullptr;
         AABB aabb;
+
+        // Child bounds, tested together with one batched slab test per node
+        AABB child_aabb[2];
+
+        // Non-null when the corresponding child is an inner node, so traversal can skip its own box test
+        BoundingVolumeNode* lnode = nullptr;
+        BoundingVolumeNode* rnode = nullptr;
+
+        // Descends into the children assuming this node's box has already been hit
+        bool traverse(const ray& r, Real t_lo, Real t_hi, hit_history &hist);
+        void refit();
 };
 
 #endif
\ No newline at end of file
@@ -4,14 +4,14 @@ AABB objs::translate_aabb(const AABB& aabb, const vec3& offset) {
     return AABB(aabb.get_lo() + offset, aabb.get_hi() + offset);
 }
 
-vec3 objs::rotate_vector(const vec3& xyz, double theta, char axis) {
+vec3 objs::rotate_vector(const vec3& xyz, Real theta, char axis) {
     auto cos_theta = cos(utils::deg_to_rad(theta));
     auto sin_theta = sin(utils::deg_to_rad(theta));
     auto x = xyz.x();
     auto y = xyz.y();
     auto z = xyz.z();
 
-    double new_x, new_y, new_z;
+    Real new_x, new_y, new_z;
 
     if (axis == 'x') {
         new_x = x;
@@ -31,4 +31,30 @@ vec3 objs::rotate_vector(const vec3& xyz, double theta, char axis) {
     }
 
     return vec3(new_x, new_y, new_z);
+}
+
+void objs::collect_emitters(std::vector<const objs*>& emitters) const {}
+
+emitter_sample objs::sample_emitter(const vec3& ref, Real u1, Real u2) const {
+    return emitter_sample();
+}
+
+Real objs::emitter_pdf(const vec3& ref, const vec3& point, const vec3& normal) const {
+    return 0;
+}
+
+emitter_sample objs::sample_area(Real u1, Real u2) const {
+    return emitter_sample();
+}
+
+Real objs::area_pdf() const {
+    return 0;
+}
+
+emitter_bounds objs::get_emitter_bounds() const {
+    return emitter_bounds();
+}
+
+const material* objs::get_material() const {
+    return nullptr;
 }
\ No newline at end of file
@@ -2,35 +2,78 @@
 #define OBJS_H
 
 #include <memory>
+#include <vector>
 #include "../material/material.h"
 #include "bvh/aabb.h"
 
 using std::shared_ptr;
 
+class objs;
+
 struct hit_history {
-    double  t1;
-    double  t2;
-    double  t;
-    double  u;
-    double  v;
+    Real    t1;
+    Real    t2;
+    Real    t;
+    Real    u;
+    Real    v;
     vec3    intersection;
     vec3    normal;
     bool    is_front;
     shared_ptr<material> material_;
+    const objs* object = nullptr;   // Primitive that was hit, for light sampling densities
+};
+
+// Point on an emitter picked for direct lighting
+struct emitter_sample {
+    vec3    point;
+    vec3    normal;
+    Real    pdf = 0;    // Per unit solid angle as seen from the reference point; 0 for no usable sample
+};
+
+// Where an emitter is, which way it emits and how much, for the light hierarchy.
+// It emits within theta_o of axis, falling off to zero over a further theta_e.
+struct emitter_bounds {
+    AABB    box;
+    vec3    axis        = vec3(0, 0, 1);
+    Real    cos_theta_o = -1;
+    Real    cos_theta_e = 0;
+    Real    power       = 0;        // Emitted luminance power
 };
 
 // Abstract parent class for surface objects (sphere, triangle, plane, etc.)
 class objs {
     public:
         virtual ~objs() = default;
-        virtual bool ray_hit(const ray& r, double t_lo, double t_hi, hit_history &hist) = 0;
+        virtual bool ray_hit(const ray& r, Real t_lo, Real t_hi, hit_history &hist) = 0;
         virtual AABB bounding_volume() const = 0;
         virtual void translate(const vec3& offset) = 0;
-        virtual void rotate(double theta, char axis) = 0;
-        
+        virtual void rotate(Real theta, char axis) = 0;
+
+        // Direct lighting support. Primitives with an emissive material add themselves, containers recurse.
+        virtual void collect_emitters(std::vector<const objs*>& emitters) const;
+
+        // Samples a point of the surface that is visible from ref, with its solid-angle density
+        virtual emitter_sample sample_emitter(const vec3& ref, Real u1, Real u2) const;
+
+        // Solid-angle density at ref of sample_emitter picking point (with surface normal normal)
+        virtual Real emitter_pdf(const vec3& ref, const vec3& point, const vec3& normal) const;
+
+        // Samples a point of the surface uniformly, for emitting photons. normal is that of the face the point emits from,
+        // and pdf is per unit area of all emitting faces together.
+        virtual emitter_sample sample_area(Real u1, Real u2) const;
+
+        // Density of sample_area per unit area, which is the same at every point
+        virtual Real area_pdf() const;
+
+        // Extent and power of an emitter
+        virtual emitter_bounds get_emitter_bounds() const;
+
+        // Material of a primitive (nullptr for containers)
+        virtual const material* get_material() const;
+
     protected:
         AABB translate_aabb(const AABB& aabb, const vec3& offset);
-        vec3 rotate_vector(const vec3& xyz, double theta, char axis);
+        vec3 rotate_vector(const vec3& xyz, Real theta, char axis);
 };
 
 #endif
\ No newline at end of file
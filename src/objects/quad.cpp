@@ -1,7 +1,8 @@
 #include "quad.h"
+#include "../color.h"
 
 Quad::Quad(const vec3& q, const vec3& u_, const vec3& v_, shared_ptr<material> mat) 
-    : cornerstone(q), u(u_), v(v_), normal(cross(u, v).unit_vector()), material_(mat) {
+    : cornerstone(q), u(u_), v(v_), normal(cross(u, v).unit_vector()), area(cross(u, v).magnitude()), material_(mat) {
     
     // Calculate all four corners of the quad
     vec3 p0 = q;           // cornerstone
@@ -32,7 +33,7 @@ AABB Quad::bounding_volume() const {
     return aabb;
 }
 
-bool Quad::ray_hit(const ray& r, double t_lo, double t_hi, hit_history &hist) {
+bool Quad::ray_hit(const ray& r, Real t_lo, Real t_hi, hit_history &hist) {
     auto ray_unit_dir = r.get_direction().unit_vector();
     auto denominator = ray_unit_dir * normal;
 
@@ -65,6 +66,7 @@ bool Quad::ray_hit(const ray& r, double t_lo, double t_hi, hit_history &hist) {
     hist.t = t;
     hist.intersection = intersection;
     hist.material_ = material_;
+    hist.object = this;
     
     if (denominator > 0) {
         hist.is_front = false;
@@ -85,8 +87,59 @@ void Quad::translate(const vec3& offset) {
 }
 
 // Caution: Revolves around the cornerstone, not the center
-void Quad::rotate(double theta, char axis) {
+void Quad::rotate(Real theta, char axis) {
     vec3 rotated_u = rotate_vector(u, theta, axis);
     vec3 rotated_v = rotate_vector(v, theta, axis);
     *this = Quad(rotate_vector(cornerstone, theta, axis), rotated_u, rotated_v, material_);
+}
+
+void Quad::collect_emitters(std::vector<const objs*>& emitters) const {
+    if (material_->is_emissive()) {
+        emitters.push_back(this);
+    }
+}
+
+emitter_sample Quad::sample_emitter(const vec3& ref, Real u1, Real u2) const {
+    // Uniform over the area, converted to solid angle
+    emitter_sample s;
+    s.point = cornerstone + u1 * u + u2 * v;
+    s.normal = normal;
+    s.pdf = emitter_pdf(ref, s.point, s.normal);
+    return s;
+}
+
+Real Quad::emitter_pdf(const vec3& ref, const vec3& point, const vec3& point_normal) const {
+    // Both faces emit, so the cosine at the light is taken unsigned
+    vec3 to_point = point - ref;
+    Real dist2 = to_point * to_point;
+    Real cos_light = std::fabs(normal * to_point) / std::sqrt(dist2);
+    return cos_light > 1e-6 ? dist2 / (cos_light * area) : 0;
+}
+
+emitter_sample Quad::sample_area(Real u1, Real u2) const {
+    // Both faces emit: the lower half of u1 picks the front, the upper half the back
+    emitter_sample s;
+    bool back = u1 >= 0.5;
+    u1 = back ? 2 * u1 - 1 : 2 * u1;
+    s.point = cornerstone + u1 * u + u2 * v;
+    s.normal = back ? -1 * normal : normal;
+    s.pdf = area_pdf();
+    return s;
+}
+
+Real Quad::area_pdf() const {
+    return 1 / (2 * area);
+}
+
+emitter_bounds Quad::get_emitter_bounds() const {
+    // Both faces emit, so the cone around the normal widens to every direction
+    emitter_bounds b;
+    b.box = aabb;
+    b.axis = normal;
+    b.power = luminance(material_->emit(cornerstone)) * M_PI * 2 * area;
+    return b;
+}
+
+const material* Quad::get_material() const {
+    return material_.get();
 }
\ No newline at end of file
@@ -7,19 +7,28 @@ class Quad : public objs {
     public:
         Quad(const vec3& q, const vec3& u, const vec3& v, shared_ptr<material> mat);
 
-        bool ray_hit(const ray& r, double t_lo, double t_hi, hit_history &hist) override;
+        bool ray_hit(const ray& r, Real t_lo, Real t_hi, hit_history &hist) override;
 
         AABB bounding_volume() const override;
 
         void translate(const vec3& offset) override;
 
-        void rotate(double theta, char axis) override;
+        void rotate(Real theta, char axis) override;
+
+        void collect_emitters(std::vector<const objs*>& emitters) const override;
+        emitter_sample sample_emitter(const vec3& ref, Real u1, Real u2) const override;
+        Real emitter_pdf(const vec3& ref, const vec3& point, const vec3& normal) const override;
+        emitter_sample sample_area(Real u1, Real u2) const override;
+        Real area_pdf() const override;
+        emitter_bounds get_emitter_bounds() const override;
+        const material* get_material() const override;
 
     private:
         vec3 cornerstone;   // Coordinate of the defining vertex
         vec3 u;
         vec3 v;
         vec3 normal;
+        Real area;          // Of one face
         AABB aabb;
         shared_ptr<material> material_;
 };
@@ -1,33 +1,35 @@
 #include "sphere.h"
+#include "../sampling/warp.h"
+#include "../color.h"
 
-sphere::sphere(double rad, const vec3& cen, shared_ptr<material> mat) : radius(rad), center(cen), material_(mat) {
+sphere::sphere(Real rad, const vec3& cen, shared_ptr<material> mat) : radius(rad), center(cen), material_(mat) {
     vec3 radvec(rad, rad, rad);
     auto lo = cen - rad;
     auto hi = cen + rad;
     aabb = AABB(lo, hi);
 }
 
-bool sphere::ray_hit(const ray& r, double t_lo, double t_hi, hit_history& hist) {
+bool sphere::ray_hit(const ray& r, Real t_lo, Real t_hi, hit_history& hist) {
     // // Problematic
     // vec3 o = center - r.get_origin();
-    // double tc = (o * r.get_direction());
-    // double d2 = (o * o) - tc * tc;
+    // Real tc = (o * r.get_direction());
+    // Real d2 = (o * o) - tc * tc;
 
     vec3 o = center - r.get_origin();
-    double tc = (o * r.get_direction());
+    Real tc = (o * r.get_direction());
     vec3 closest_point_vec = o - tc * r.get_direction();
-    double d2 = closest_point_vec * closest_point_vec;
-    double radius2 = radius * radius;
+    Real d2 = closest_point_vec * closest_point_vec;
+    Real radius2 = radius * radius;
 
     if (tc < 0 || d2 > radius2) {
         return false;
     }
 
-    double offset = sqrt(radius2 - d2);
-    double t1 = tc - offset;
-    double t2 = tc + offset;
+    Real offset = sqrt(radius2 - d2);
+    Real t1 = tc - offset;
+    Real t2 = tc + offset;
 
-    double t;
+    Real t;
     if (t1 > t_lo && t1 < t_hi) {
         t = t1;
     } else if (t2 > t_lo && t2 < t_hi) {
@@ -51,6 +53,7 @@ bool sphere::ray_hit(const ray& r, double t_lo, double t_hi, hit_history& hist)
     }
     hist.normal = normal;
     hist.material_ = material_;
+    hist.object = this;
 
     // Apply rotations in order: X, then Y, then Z
     vec3 rotated_normal = normal;    
@@ -65,8 +68,8 @@ bool sphere::ray_hit(const ray& r, double t_lo, double t_hi, hit_history& hist)
     }
 
     // Calculate UV coordinates using the rotated normal
-    hist.u = (std::atan2(-rotated_normal.z(), rotated_normal.x()) + M_PI) / (2 * M_PI);
-    hist.v = (std::acos(-rotated_normal.y())) / M_PI;
+    hist.u = (fastmath::atan2(-rotated_normal.z(), rotated_normal.x()) + M_PI) / (2 * M_PI);
+    hist.v = (fastmath::acos(-rotated_normal.y())) / M_PI;
 
     // hist.u = (std::atan2(-normal.z(), normal.x()) + M_PI) / (2 * M_PI);
     // hist.v = (std::acos(-normal.y())) / M_PI;
@@ -83,7 +86,7 @@ void sphere::translate(const vec3& offset) {
     aabb = translate_aabb(aabb, offset);
 }
 
-void sphere::rotate(double theta, char axis) {
+void sphere::rotate(Real theta, char axis) {
     if (axis == 'x') {
         x_theta += theta;
     } else if (axis == 'y') {
@@ -94,4 +97,87 @@ void sphere::rotate(double theta, char axis) {
         std::cerr << "Rotation: Invalid Axis" << std::endl;
         exit(1);
     }
+}
+
+void sphere::collect_emitters(std::vector<const objs*>& emitters) const {
+    if (material_->is_emissive()) {
+        emitters.push_back(this);
+    }
+}
+
+emitter_sample sphere::sample_emitter(const vec3& ref, Real u1, Real u2) const {
+    emitter_sample s;
+    vec3 to_center = center - ref;
+    Real dist2 = to_center * to_center;
+    Real radius2 = radius * radius;
+
+    if (dist2 <= radius2) {
+        // Inside: uniform over the surface, converted to solid angle
+        s.normal = warp::square_to_uniform_sphere(u1, u2);
+        s.point = center + radius * s.normal;
+        s.pdf = emitter_pdf(ref, s.point, s.normal);
+        return s;
+    }
+
+    // Outside: uniform over the cone of directions the sphere subtends (PBRT 6.2.3)
+    Real sin2_max = radius2 / dist2;
+    Real cos_max = std::sqrt(std::fmax(Real(0), 1 - sin2_max));
+    Real one_minus_cos_max = sin2_max / (1 + cos_max);    // Stable for small, distant spheres
+
+    Real cos_theta = 1 - u1 * one_minus_cos_max;
+    Real sin2_theta = std::fmax(Real(0), 1 - cos_theta * cos_theta);
+    Real phi = 2 * M_PI * u2;
+    Real dist = std::sqrt(dist2);
+
+    // Distance along the sampled direction to the near side of the sphere
+    Real along = dist * cos_theta - std::sqrt(std::fmax(Real(0), radius2 - dist2 * sin2_theta));
+    warp::onb frame(to_center / dist);
+    Real sin_theta = std::sqrt(sin2_theta);
+    vec3 dir = frame.to_world(vec3(sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta));
+
+    s.point = ref + along * dir;
+    s.normal = (s.point - center) / radius;
+    s.pdf = 1 / (2 * M_PI * one_minus_cos_max);
+    return s;
+}
+
+Real sphere::emitter_pdf(const vec3& ref, const vec3& point, const vec3& normal) const {
+    vec3 to_center = center - ref;
+    Real dist2 = to_center * to_center;
+    Real radius2 = radius * radius;
+
+    if (dist2 <= radius2) {
+        vec3 to_point = point - ref;
+        Real d2 = to_point * to_point;
+        Real cos_light = std::fabs(normal * to_point) / std::sqrt(d2);
+        return cos_light > 0 ? d2 / (cos_light * 4 * M_PI * radius2) : 0;
+    }
+
+    Real sin2_max = radius2 / dist2;
+    Real cos_max = std::sqrt(std::fmax(Real(0), 1 - sin2_max));
+    return 1 / (2 * M_PI * sin2_max / (1 + cos_max));
+}
+
+emitter_sample sphere::sample_area(Real u1, Real u2) const {
+    emitter_sample s;
+    s.normal = warp::square_to_uniform_sphere(u1, u2);
+    s.point = center + radius * s.normal;
+    s.pdf = area_pdf();
+    return s;
+}
+
+Real sphere::area_pdf() const {
+    return 1 / (4 * M_PI * radius * radius);
+}
+
+emitter_bounds sphere::get_emitter_bounds() const {
+    // Emits in every direction: radiance times pi (per unit area) times the surface area
+    emitter_bounds b;
+    b.box = aabb;
+    b.power = luminance(material_->emit(center)) * M_PI * 4 * M_PI * radius * radius;
+    return b;
+}
+
+const material* sphere::get_material() const {
+    return material_.get();
 }
\ No newline at end of file
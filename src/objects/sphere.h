@@ -2,26 +2,35 @@
 #define SPHERE_H
 
 #include "objs.h"
+#include "../fastmath.h"
 
 // Child class of objs
 class sphere : public objs {
     public:
-        sphere(double rad, const vec3 &cen, shared_ptr<material> mat);
-        bool ray_hit(const ray& r, double t_lo, double t_hi, hit_history &hist) override;
+        sphere(Real rad, const vec3 &cen, shared_ptr<material> mat);
+        bool ray_hit(const ray& r, Real t_lo, Real t_hi, hit_history &hist) override;
         AABB bounding_volume() const override;
         void translate(const vec3& offset) override;
-        void rotate(double theta, char axis) override;
+        void rotate(Real theta, char axis) override;
+
+        void collect_emitters(std::vector<const objs*>& emitters) const override;
+        emitter_sample sample_emitter(const vec3& ref, Real u1, Real u2) const override;
+        Real emitter_pdf(const vec3& ref, const vec3& point, const vec3& normal) const override;
+        emitter_sample sample_area(Real u1, Real u2) const override;
+        Real area_pdf() const override;
+        emitter_bounds get_emitter_bounds() const override;
+        const material* get_material() const override;
 
     private:
-        double  radius;
+        Real    radius;
         vec3    center;
         AABB    aabb;
         shared_ptr<material> material_;
 
         // Rotation angles for textures
-        double x_theta = 0;
-        double y_theta = 0;
-        double z_theta = 0;
+        Real x_theta = 0;
+        Real y_theta = 0;
+        Real z_theta = 0;
 };
 
 #endif
\ No newline at end of file
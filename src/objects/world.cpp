@@ -26,14 +26,20 @@ void world::translate(const vec3& offset) {
     }
 }
 
-void world::rotate(double theta, char axis) {
+void world::rotate(Real theta, char axis) {
     for (auto object : objects) {
         object->rotate(theta, axis);
     }
 }
 
+void world::collect_emitters(std::vector<const objs*>& emitters) const {
+    for (const auto& object : objects) {
+        object->collect_emitters(emitters);
+    }
+}
+
 // Maybe return the closest object hit (null for none) instead of bool? 
-bool world::ray_hit(const ray& r, double t_lo, double t_hi, hit_history &hist) {
+bool world::ray_hit(const ray& r, Real t_lo, Real t_hi, hit_history &hist) {
     hit_history tmp;
     bool hit = false;
     auto nearest = t_hi;
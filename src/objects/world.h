@@ -17,13 +17,15 @@ class world : public objs {
         void insert(shared_ptr<objs> object);
         void wipe();
 
-        bool ray_hit(const ray& r, double t_lo, double t_hi, hit_history &hist) override;
+        bool ray_hit(const ray& r, Real t_lo, Real t_hi, hit_history &hist) override;
 
         AABB bounding_volume() const override;
 
         void translate(const vec3& offset) override;
 
-        void rotate(double theta, char axis) override;
+        void rotate(Real theta, char axis) override;
+
+        void collect_emitters(std::vector<const objs*>& emitters) const override;
     
         private:
             AABB aabb;
@@ -1,15 +1,34 @@
 #include "ray.h"
 
-ray::ray(const vec3 &init, const vec3 &dir) : origin(init), direction(dir.unit_vector()) {}
+ray::ray(const vec3 &init, const vec3 &dir) : origin(init), direction(dir.unit_vector()) {
+    // Division by a signed zero yields a correctly signed infinity, which the slab test relies on
+    inv_direction = vec3(1 / direction.x(), 1 / direction.y(), 1 / direction.z());
+}
 
 vec3 ray::get_origin() const {
     return origin;
 }
 
 vec3 ray::get_direction() const {
-    return direction.unit_vector();
+    // Already normalized by the constructor
+    return direction;
 }
 
-vec3 ray::parametric_loc(double t) const {
+vec3 ray::parametric_loc(Real t) const {
     return origin + direction * t;
+}
+
+void ray_batch::resize(int n) {
+    ox.resize(n); oy.resize(n); oz.resize(n);
+    dx.resize(n); dy.resize(n); dz.resize(n);
+    pixel.resize(n);
+    count = n;
+}
+
+int ray_batch::size() const {
+    return count;
+}
+
+ray ray_batch::get(int i) const {
+    return ray(vec3(ox[i], oy[i], oz[i]), vec3(dx[i], dy[i], dz[i]));
 }
\ No newline at end of file
@@ -1,19 +1,39 @@
 #ifndef RAY_H
 #define RAY_H
 
+#include <vector>
 #include "vec3.h"
 
 class ray {
     private:
         vec3 origin;
         vec3 direction;
+        vec3 inv_direction;     // Componentwise 1 / direction; +-inf for zero components
 
     public:
         ray(const vec3 &init, const vec3 &dir);
 
         vec3 get_origin() const;
         vec3 get_direction() const;
-        vec3 parametric_loc(double t) const;
+        const vec3& get_inv_direction() const { return inv_direction; }
+        vec3 parametric_loc(Real t) const;
+};
+
+// Structure-of-arrays ray buffer, filled by batched generators and consumed by packet traversal
+class ray_batch {
+    public:
+        std::vector<Real>   ox, oy, oz;
+        std::vector<Real>   dx, dy, dz;
+        std::vector<int>    pixel;          // Linear pixel index (j * width + i) each ray belongs to
+
+        void resize(int n);
+        int  size() const;
+
+        // Reassembles the i-th ray
+        ray  get(int i) const;
+
+    private:
+        int count = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,330 @@
+#include "bdpt.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include "../sampling/warp.h"
+
+namespace {
+    // Delta vertices have no density; as in PBRT they count as 1 in the ratios of the MIS weights
+    inline Real remap0(Real pdf) {
+        return pdf != 0 ? pdf : 1;
+    }
+
+    bool is_black(const color& c) {
+        return c.x() <= 0 && c.y() <= 0 && c.z() <= 0;
+    }
+}
+
+void bdpt_emitters::build(objs& scene) {
+    emitters.clear();
+    power_cdf.clear();
+    pmf.clear();
+    std::vector<const objs*> all;
+    scene.collect_emitters(all);
+    Real total = 0;
+    for (const objs* e : all) {
+        Real power = e->get_emitter_bounds().power;
+        if (power > 0 && e->area_pdf() > 0) {
+            emitters.push_back(e);
+            total += power;
+            power_cdf.push_back(total);
+        }
+    }
+    for (size_t i = 0; i < emitters.size(); i++) {
+        pmf[emitters[i]] = (power_cdf[i] - (i > 0 ? power_cdf[i - 1] : 0)) / total;
+    }
+}
+
+bdpt_integrator::bdpt_integrator(objs& scene, const bdpt_emitters& lights, const color& background, int max_depth, int rr_start_depth)
+    : scene(scene), lights(lights), background(background), max_depth(max_depth), rr_start_depth(rr_start_depth) {
+    // A camera subpath holds the camera and max_depth + 1 surface vertices, a light subpath the light and max_depth more
+    camera_path.resize(max_depth + 2);
+    light_path.resize(max_depth + 1);
+    camera_densities.resize(camera_path.size());
+    light_densities.resize(light_path.size());
+}
+
+bool bdpt_integrator::sample_light(vertex& out, Real u0, Real u1, Real u2) const {
+    const auto& cdf = lights.power_cdf;
+    if (cdf.empty()) {
+        return false;
+    }
+    Real target = u0 * cdf.back();
+    size_t i = std::min(static_cast<size_t>(std::upper_bound(cdf.begin(), cdf.end(), target) - cdf.begin()), cdf.size() - 1);
+    const objs* e = lights.emitters[i];
+    emitter_sample s = e->sample_area(u1, u2);
+    Real pdf = lights.pmf.at(e) * s.pdf;
+    if (!(pdf > 0)) {
+        return false;
+    }
+
+    out = vertex();
+    out.point = s.point;
+    out.normal = s.normal;
+    out.mat = e->get_material();
+    out.object = e;
+    out.light_origin = true;
+    out.pdf_fwd = pdf;
+    out.beta = out.mat->emit(s.point) / pdf;
+    return true;
+}
+
+int bdpt_integrator::light_subpath() {
+    vertex& origin = light_path[0];
+    if (!sample_light(origin, utils::random_double(0, 1), utils::random_double(0, 1), utils::random_double(0, 1))) {
+        return 0;
+    }
+
+    // Cosine-distributed emission: the cosine of the radiance cancels against the direction's density, leaving pi
+    warp::onb frame(origin.normal);
+    vec3 local = warp::square_to_cosine_hemisphere(utils::random_double(0, 1), utils::random_double(0, 1));
+    Real pdf_dir = warp::cosine_hemisphere_pdf(local.z());
+    if (pdf_dir <= 0) {
+        return 1;
+    }
+    color beta = origin.beta * M_PI;
+    return random_walk(ray(origin.point, frame.to_world(local)), beta, pdf_dir, false, light_path, nullptr);
+}
+
+int bdpt_integrator::random_walk(ray r, color beta, Real pdf_dir, bool from_camera, std::vector<vertex>& path, color* escaped) {
+    int count = 1;
+    for (int bounce = 0; count < static_cast<int>(path.size()); bounce++) {
+        hit_history hist;
+        if (!scene.ray_hit(r, 1e-4, std::numeric_limits<Real>::infinity(), hist)) {
+            if (escaped) {
+                *escaped += hadamard(beta, background);
+            }
+            break;
+        }
+
+        vertex& prev = path[count - 1];
+        vertex& v = path[count];
+        v = vertex();
+        v.point = hist.intersection;
+        v.normal = hist.normal;
+        v.mat = hist.material_.get();
+        v.object = hist.object;
+        v.u = hist.u;
+        v.v = hist.v;
+        v.beta = beta;
+        v.pdf_fwd = to_area(pdf_dir, prev, v);
+
+        // Camera subpaths end at emitters, which they keep for the strategy that uses no light vertex;
+        // light subpaths are absorbed there
+        if (v.mat->is_emissive()) {
+            count += from_camera ? 1 : 0;
+            break;
+        }
+        count++;
+
+        auto bs = v.mat->sample(r, hist.normal, hist.intersection, hist.is_front, hist.u, hist.v);
+        if ((!bs.specular && bs.pdf <= 0) || is_black(bs.weight)) {
+            break;
+        }
+        vec3 wo = r.get_direction().unit_vector() * -1;
+        v.delta = bs.specular;
+        pdf_dir = bs.specular ? 0 : bs.pdf;
+        prev.pdf_rev = to_area(bs.specular ? 0 : v.mat->pdf(wo, v.normal), v, prev);
+        beta = hadamard(beta, bs.weight);
+
+        // Russian roulette on the bounce's weight, as in ray_color
+        if (bounce + 1 >= rr_start_depth) {
+            Real survive = std::fmin(max_component(bs.weight), Real(0.95));
+            if (utils::random_double(0, 1) >= survive) {
+                break;
+            }
+            beta /= survive;
+        }
+        r = bs.scattered;
+    }
+    return count;
+}
+
+color bdpt_integrator::emitted(const vertex& light, const vec3& to) {
+    return (to - light.point) * light.normal > 0 ? light.mat->emit(light.point) : color(0, 0, 0);
+}
+
+color bdpt_integrator::bsdf(const vertex& v, const vec3& from, const vec3& to) {
+    // Materials with a density only reflect, so both directions must lie on the normal's side
+    vec3 wi = (from - v.point).unit_vector();
+    Real cos_i = wi * v.normal;
+    if (cos_i <= 0 || (to - v.point) * v.normal <= 0) {
+        return color(0, 0, 0);
+    }
+    return v.mat->eval(wi, v.normal, v.u, v.v, v.point) / cos_i;
+}
+
+Real bdpt_integrator::to_area(Real pdf_dir, const vertex& from, const vertex& to) {
+    vec3 w = to.point - from.point;
+    Real dist2 = w * w;
+    if (dist2 <= 0) {
+        return 0;
+    }
+    Real pdf = pdf_dir / dist2;
+    if (to.mat) {
+        pdf *= std::fabs(to.normal * w) / std::sqrt(dist2);
+    }
+    return pdf;
+}
+
+Real bdpt_integrator::pdf_emission(const vertex& light, const vertex& next) {
+    vec3 w = (next.point - light.point).unit_vector();
+    return to_area(warp::cosine_hemisphere_pdf(w * light.normal), light, next);
+}
+
+Real bdpt_integrator::pdf(const vertex& v, const vertex& next) {
+    if (v.light_origin) {
+        return pdf_emission(v, next);
+    }
+    vec3 w = (next.point - v.point).unit_vector();
+    return to_area(v.mat->pdf(w, v.normal), v, next);
+}
+
+Real bdpt_integrator::pdf_light_origin(const vertex& light) const {
+    auto it = lights.pmf.find(light.object);
+    return it != lights.pmf.end() ? it->second * light.object->area_pdf() : 0;
+}
+
+bool bdpt_integrator::visible(const vertex& a, const vertex& b) const {
+    vec3 w = b.point - a.point;
+    Real dist = w.magnitude();
+    hit_history blocker;
+    return !scene.ray_hit(ray(a.point, w / dist), 1e-4, dist * (1 - 1e-4), blocker);
+}
+
+color bdpt_integrator::connect(int s, int t, vertex* sampled) {
+    const vertex& pt = camera_path[t - 1];
+    const vertex& pt_prev = camera_path[t - 2];
+
+    // No light vertex: the camera subpath itself ended on an emitter
+    if (s == 0) {
+        return pt.mat->is_emissive() ? hadamard(pt.beta, emitted(pt, pt_prev.point)) : color(0, 0, 0);
+    }
+    if (pt.mat->is_emissive() || !pt.mat->has_density()) {
+        return color(0, 0, 0);
+    }
+
+    // One light vertex: a fresh point on an emitter, as in next event estimation
+    const vertex* qs;
+    color light_side;
+    if (s == 1) {
+        if (!sample_light(*sampled, utils::random_double(0, 1), utils::random_double(0, 1), utils::random_double(0, 1))) {
+            return color(0, 0, 0);
+        }
+        qs = sampled;
+        light_side = qs->beta;
+        if ((pt.point - qs->point) * qs->normal <= 0) {
+            return color(0, 0, 0);
+        }
+    } else {
+        qs = &light_path[s - 1];
+        if (qs->delta || !qs->mat->has_density()) {
+            return color(0, 0, 0);
+        }
+        light_side = hadamard(qs->beta, bsdf(*qs, light_path[s - 2].point, pt.point));
+    }
+
+    vec3 w = qs->point - pt.point;
+    Real dist2 = w * w;
+    if (dist2 <= 0) {
+        return color(0, 0, 0);
+    }
+    Real geometry = std::fabs(qs->normal * w) * std::fabs(pt.normal * w) / (dist2 * dist2);
+    color c = hadamard(hadamard(light_side, bsdf(pt, qs->point, pt_prev.point)), pt.beta) * geometry;
+    if (is_black(c) || !visible(pt, *qs)) {
+        return color(0, 0, 0);
+    }
+    return c;
+}
+
+Real bdpt_integrator::mis_weight(int s, int t, const vertex* sampled) {
+    // With the strategies of t = 1 left out, a camera ray hitting a light has no alternative
+    if (s + t == 2) {
+        return 1;
+    }
+
+    // Densities of both subpaths as this strategy connects them; the vertices at the connection get their reverse
+    // densities from the other side, and are not delta there
+    auto& light = light_densities;
+    auto& cam = camera_densities;
+    for (int i = 0; i < s; i++) {
+        const vertex& v = (s == 1 && i == 0) ? *sampled : light_path[i];
+        light[i] = {v.pdf_fwd, v.pdf_rev, v.delta};
+    }
+    for (int i = 0; i < t; i++) {
+        cam[i] = {camera_path[i].pdf_fwd, camera_path[i].pdf_rev, camera_path[i].delta};
+    }
+
+    const vertex& pt = camera_path[t - 1];
+    const vertex& pt_prev = camera_path[t - 2];
+    cam[t - 1].delta = false;
+    if (s > 0) {
+        const vertex& qs = s == 1 ? *sampled : light_path[s - 1];
+        light[s - 1].delta = false;
+        cam[t - 1].rev = pdf(qs, pt);
+        cam[t - 2].rev = pdf(pt, pt_prev);
+        light[s - 1].rev = pdf(pt, qs);
+        if (s > 1) {
+            light[s - 2].rev = pdf(qs, light_path[s - 2]);
+        }
+    } else {
+        cam[t - 1].rev = pdf_light_origin(pt);
+        cam[t - 2].rev = pdf_emission(pt, pt_prev);
+    }
+
+    // Ratios of every other strategy's density to this one's: moving the connection towards the camera (down to t = 2),
+    // then towards the light (down to s = 0)
+    Real sum = 0;
+    Real ratio = 1;
+    for (int i = t - 1; i > 1; i--) {
+        ratio *= remap0(cam[i].rev) / remap0(cam[i].fwd);
+        if (!cam[i].delta && !cam[i - 1].delta) {
+            sum += ratio;
+        }
+    }
+    ratio = 1;
+    for (int i = s - 1; i >= 0; i--) {
+        ratio *= remap0(light[i].rev) / remap0(light[i].fwd);
+        bool previous_delta = i > 0 && light[i - 1].delta;
+        if (!light[i].delta && !previous_delta) {
+            sum += ratio;
+        }
+    }
+    return 1 / (1 + sum);
+}
+
+color bdpt_integrator::trace(const ray& primary, aov_sample* aov) {
+    vertex& cam = camera_path[0];
+    cam = vertex();
+    cam.point = primary.get_origin();
+    cam.beta = color(1, 1, 1);
+
+    color radiance(0, 0, 0);
+    const int camera_count = random_walk(primary, color(1, 1, 1), 1, true, camera_path, &radiance);
+    if (aov) {
+        *aov = aov_sample();
+        if (camera_count > 1) {
+            const vertex& first = camera_path[1];
+            Real t = (first.point - cam.point).magnitude() / primary.get_direction().magnitude();
+            *aov = {first.mat->get_albedo(first.u, first.v, first.point), first.normal, t, true};
+        } else {
+            aov->albedo = background;
+        }
+    }
+    const int light_count = light_subpath();
+
+    // Every strategy of at most max_depth bounces
+    vertex sampled;
+    for (int t = 2; t <= camera_count; t++) {
+        for (int s = 0; s <= light_count; s++) {
+            if (s + t - 2 > max_depth) {
+                break;
+            }
+            color c = connect(s, t, &sampled);
+            if (!is_black(c)) {
+                radiance += c * mis_weight(s, t, &sampled);
+            }
+        }
+    }
+    return radiance;
+}
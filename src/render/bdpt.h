@@ -0,0 +1,113 @@
+#ifndef BDPT_H
+#define BDPT_H
+
+#include <vector>
+#include <unordered_map>
+#include "../ray.h"
+#include "../color.h"
+#include "../objects/objs.h"
+#include "film.h"
+
+/*
+    Bidirectional path tracer (Veach 1997, following the structure of PBRT-v3's BDPT). Every camera sample traces
+    a camera subpath and a light subpath, then connects every prefix of one to every prefix of the other with a
+    shadow ray; each of these strategies estimates the same light, and they are combined with the balance
+    heuristic, computed from the forward and reverse area densities stored at every vertex.
+
+    Light subpaths start on an emitter picked by power, at a uniform point of its surface, in a cosine-distributed
+    direction. Where light leaves a small bulb through an opening, a few light vertices on the walls it reaches
+    stand in for the many camera paths that would have to find the opening by chance.
+
+    Strategies that connect a light vertex straight to the camera (t = 1) are left out: they land in arbitrary
+    pixels, which the tiled accumulation buffers cannot take. The MIS weights only count the strategies that are
+    used, so the estimate stays unbiased; caustics seen directly converge no faster than with ray_color.
+    Mirrors and glass are delta vertices that paths pass through but cannot connect at.
+*/
+
+// Emitters that light subpaths start from, picked by power. Built once per frame and shared by every integrator.
+struct bdpt_emitters {
+    std::vector<const objs*>                emitters;
+    std::vector<Real>                       power_cdf;
+    std::unordered_map<const objs*, Real>   pmf;
+
+    void    build(objs& scene);
+};
+
+class bdpt_integrator {
+    public:
+        // Paths are at most max_depth bounces long; subpaths may end by Russian roulette after rr_start_depth bounces.
+        // lights must be built from scene and outlive the integrator.
+        bdpt_integrator(objs& scene, const bdpt_emitters& lights, const color& background, int max_depth, int rr_start_depth);
+
+        // Radiance along the primary ray. aov, if given, receives its first hit.
+        color   trace(const ray& primary, aov_sample* aov = nullptr);
+
+    private:
+        struct vertex {
+            vec3            point;
+            vec3            normal;                 // Facing the side the subpath arrived from (light origins: the emitting side)
+            const material* mat         = nullptr;  // nullptr at the camera
+            const objs*     object      = nullptr;  // Primitive, to find the pick probability of emitters
+            Real            u           = 0;
+            Real            v           = 0;
+            color           beta;                   // Subpath throughput up to and including the vertex
+            bool            delta       = false;    // Scattered by a mirror or glass
+            bool            light_origin = false;   // First vertex of a light subpath
+            Real            pdf_fwd     = 0;        // Area density of the vertex as its subpath sampled it
+            Real            pdf_rev     = 0;        // ... and as the other direction would have
+        };
+
+        objs&                   scene;
+        const bdpt_emitters&    lights;
+        color                   background;
+        int                     max_depth;
+        int                     rr_start_depth;
+
+        // Densities of a vertex as mis_weight sees them for one strategy
+        struct densities {
+            Real    fwd;
+            Real    rev;
+            bool    delta;
+        };
+
+        // Subpaths and MIS scratch, reused across calls
+        std::vector<vertex>     camera_path;
+        std::vector<vertex>     light_path;
+        std::vector<densities>  camera_densities;
+        std::vector<densities>  light_densities;
+
+        // Extends path (holding its first vertex) along r, sampled with solid-angle density pdf_dir. Returns the vertex count.
+        // Camera paths add what escapes the scene to escaped, and keep the emitter they end at as their last vertex.
+        int     random_walk(ray r, color beta, Real pdf_dir, bool from_camera, std::vector<vertex>& path, color* escaped);
+        int     light_subpath();
+
+        // Picks an emitter and a point on it. False when the scene has nothing to pick.
+        bool    sample_light(vertex& out, Real u0, Real u1, Real u2) const;
+
+        // Emitted radiance of an emitter vertex towards to
+        static color   emitted(const vertex& light, const vec3& to);
+
+        // BSDF (without the cosine) of v for light from `from` scattered towards `to`
+        static color   bsdf(const vertex& v, const vec3& from, const vec3& to);
+
+        // Area density at next of v sampling the direction towards it (emitting, at light origins). The materials
+        // with a density do not depend on where the path came from.
+        static Real pdf(const vertex& v, const vertex& next);
+        // Area density at next of an emitter vertex emitting towards it
+        static Real pdf_emission(const vertex& light, const vertex& next);
+        // Area density of a light subpath starting at the emitter vertex
+        Real    pdf_light_origin(const vertex& light) const;
+
+        // Converts a solid-angle density at from to an area density at to
+        static Real to_area(Real pdf_dir, const vertex& from, const vertex& to);
+
+        bool    visible(const vertex& a, const vertex& b) const;
+
+        // Balance heuristic weight of the strategy with s light and t camera vertices. sampled replaces the last light vertex for s = 1.
+        Real    mis_weight(int s, int t, const vertex* sampled);
+
+        // Contribution of strategy (s, t), t >= 2, before its MIS weight
+        color   connect(int s, int t, vertex* sampled);
+};
+
+#endif
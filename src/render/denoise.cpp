@@ -0,0 +1,257 @@
+#include "denoise.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+// GCC vectorizes only the cheapest loops at -O2 (its "very cheap" cost model), which the tap loop is not: let it
+// weigh the loop's alias checks and prologue against the speed-up, as -O3 does. Confirm with -fopt-info-vec.
+#pragma GCC push_options
+#pragma GCC optimize("tree-loop-vectorize", "vect-cost-model=dynamic")
+namespace {
+    // B3-spline taps of the a-trous kernel
+    constexpr float kernel[5] = {1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16};
+
+    // e^x for x <= 0, branch-free so that the tap loops vectorize. 2^(x log2 e) is split into an integer part, put
+    // straight into the exponent bits, and a fraction taken by its Taylor polynomial (|rel err| < 3e-4, plenty for weights).
+    // Under GCC's default strict float semantics, selects on float compares and std::floor keep the tap loop from
+    // being if-converted, so x is clamped to -80 arithmetically (max(a, b) = (a + b + |a - b|) / 2) and the exponent
+    // floored by truncating it shifted positive.
+    inline float exp_neg(float x) {
+        x = (x - 80.0f + std::fabs(x + 80.0f)) * 0.5f;
+        float t = x * 1.44269504f;
+        int32_t whole = static_cast<int32_t>(t + 128.0f) - 128;
+        float f = t - static_cast<float>(whole);
+        float p = 1.0f + f * (0.6931472f + f * (0.2402265f + f * (0.0555041f + f * (0.0096181f + f * 0.0013333f))));
+        int32_t bits = (whole + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        return p * scale;
+    }
+
+    // max(0, x)^128 by seven squarings: normals must agree to within a few degrees. The max is arithmetic, like the
+    // clamp in exp_neg.
+    inline float normal_weight(float x) {
+        x = (x + std::fabs(x)) * 0.5f;
+        x *= x; x *= x; x *= x; x *= x;
+        x *= x; x *= x; x *= x;
+        return x;
+    }
+
+    inline float luminance(float r, float g, float b) {
+        return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+    }
+
+    // Planar copy of everything the filter reads, one float per pixel and channel
+    struct planes {
+        int width = 0;
+        int height = 0;
+        std::vector<float> r, g, b, var;        // Demodulated radiance and its luminance variance (ping-ponged)
+        std::vector<float> nx, ny, nz;          // Unit first-hit normal
+        std::vector<float> depth, depth_grad;
+        std::vector<float> hit;                 // 1 where some sample hit the scene
+
+        void resize(int w, int h) {
+            width = w;
+            height = h;
+            const size_t n = static_cast<size_t>(w) * h;
+            for (auto* v : {&r, &g, &b, &var, &nx, &ny, &nz, &depth, &depth_grad, &hit}) {
+                v->assign(n, 0.0f);
+            }
+        }
+    };
+
+    // One pass with taps `step` pixels apart, from src into dst (radiance and variance; the guides are shared)
+    void atrous_pass(const planes& src, planes& dst, const std::vector<float>& noise, int step,
+                     const denoise_settings& settings, thread_pool& pool) {
+        const int w = src.width;
+        const int h = src.height;
+
+        pool.parallel_for(h, [&](int y, int) {
+            std::vector<float> sum_r(w, 0.0f), sum_g(w, 0.0f), sum_b(w, 0.0f), sum_w(w, 0.0f), sum_var(w, 0.0f);
+            const size_t row = static_cast<size_t>(y) * w;
+
+            // Center values of the row
+            const float* cr = &src.r[row];
+            const float* cg = &src.g[row];
+            const float* cb = &src.b[row];
+            const float* cnx = &src.nx[row];
+            const float* cny = &src.ny[row];
+            const float* cnz = &src.nz[row];
+            const float* cz = &src.depth[row];
+            const float* cgrad = &src.depth_grad[row];
+            const float* chit = &src.hit[row];
+            const float* cnoise = &noise[row];
+
+            for (int ky = 0; ky < 5; ky++) {
+                const int qy = y + (ky - 2) * step;
+                if (qy < 0 || qy >= h) {
+                    continue;
+                }
+                for (int kx = 0; kx < 5; kx++) {
+                    const int dx = (kx - 2) * step;
+                    const float h_k = kernel[kx] * kernel[ky];
+                    const float distance = std::sqrt(static_cast<float>((kx - 2) * (kx - 2) + (ky - 2) * (ky - 2))) * step;
+
+                    // Centers whose tap lands inside the image
+                    const int x_lo = std::max(0, -dx);
+                    const int x_hi = std::min(w, w - dx);
+                    // Offset so that index x reads the tap of center x
+                    const std::ptrdiff_t tap_row = static_cast<std::ptrdiff_t>(qy) * w + dx;
+                    const float* tr = src.r.data() + tap_row;
+                    const float* tg = src.g.data() + tap_row;
+                    const float* tb = src.b.data() + tap_row;
+                    const float* tvar = src.var.data() + tap_row;
+                    const float* tnx = src.nx.data() + tap_row;
+                    const float* tny = src.ny.data() + tap_row;
+                    const float* tnz = src.nz.data() + tap_row;
+                    const float* tz = src.depth.data() + tap_row;
+                    const float* thit = src.hit.data() + tap_row;
+
+                    // The sums alias none of the planes; without saying so, the loop needs more run-time alias
+                    // checks than GCC's vectorizer makes
+                    #pragma GCC ivdep
+                    for (int x = x_lo; x < x_hi; x++) {
+                        float l_center = luminance(cr[x], cg[x], cb[x]);
+                        float l_tap = luminance(tr[x], tg[x], tb[x]);
+                        float e_lum = std::fabs(l_center - l_tap) / (settings.sigma_luminance * cnoise[x] + 1e-4f);
+                        float e_depth = std::fabs(cz[x] - tz[x]) / (settings.sigma_depth * cgrad[x] * distance + 1e-3f * cz[x] + 1e-6f);
+                        float wn = normal_weight(cnx[x] * tnx[x] + cny[x] * tny[x] + cnz[x] * tnz[x]);
+                        float weight = h_k * wn * exp_neg(-(e_lum + e_depth)) * thit[x];
+
+                        sum_r[x] += weight * tr[x];
+                        sum_g[x] += weight * tg[x];
+                        sum_b[x] += weight * tb[x];
+                        sum_w[x] += weight;
+                        sum_var[x] += weight * weight * tvar[x];
+                    }
+                }
+            }
+
+            // The center tap always has weight h(0)^2 > 0 at hits, so sum_w only vanishes at misses, which keep their value
+            for (int x = 0; x < w; x++) {
+                const size_t p = row + x;
+                bool filtered = chit[x] > 0 && sum_w[x] > 0;
+                float inv = filtered ? 1.0f / sum_w[x] : 0.0f;
+                dst.r[p] = filtered ? sum_r[x] * inv : src.r[p];
+                dst.g[p] = filtered ? sum_g[x] * inv : src.g[p];
+                dst.b[p] = filtered ? sum_b[x] * inv : src.b[p];
+                dst.var[p] = filtered ? sum_var[x] * inv * inv : src.var[p];
+            }
+        });
+    }
+
+    // Standard deviation of the noise from a 3x3 blur of the variance, which is itself noisy at low sample counts
+    void estimate_noise(const planes& p, std::vector<float>& noise, thread_pool& pool) {
+        const int w = p.width;
+        const int h = p.height;
+        pool.parallel_for(h, [&](int y, int) {
+            static constexpr float blur[3] = {0.25f, 0.5f, 0.25f};
+            for (int x = 0; x < w; x++) {
+                float sum = 0;
+                float weight = 0;
+                for (int j = -1; j <= 1; j++) {
+                    for (int i = -1; i <= 1; i++) {
+                        int qx = x + i;
+                        int qy = y + j;
+                        if (qx < 0 || qy < 0 || qx >= w || qy >= h) {
+                            continue;
+                        }
+                        size_t q = static_cast<size_t>(qy) * w + qx;
+                        float k = blur[i + 1] * blur[j + 1] * p.hit[q];
+                        sum += k * p.var[q];
+                        weight += k;
+                    }
+                }
+                noise[static_cast<size_t>(y) * w + x] = weight > 0 ? std::sqrt(std::max(0.0f, sum / weight)) : 0.0f;
+            }
+        });
+    }
+}
+#pragma GCC pop_options
+
+namespace denoise {
+    void atrous(film& f, const std::vector<float>& variance, thread_pool& pool, const denoise_settings& settings) {
+        if (!f.has(aov::albedo) || !f.has(aov::normal) || !f.has(aov::depth)) {
+            return;
+        }
+        const int w = f.get_width();
+        const int h = f.get_height();
+        const float eps = 1e-3f;
+
+        planes a, b;
+        a.resize(w, h);
+        b.resize(w, h);
+
+        // Demodulate and gather the guides
+        pool.parallel_for(h, [&](int y, int) {
+            for (int x = 0; x < w; x++) {
+                const size_t p = static_cast<size_t>(y) * w + x;
+                const float* beauty = f.pixel(aov::beauty, x, y);
+                const float* albedo = f.pixel(aov::albedo, x, y);
+                const float* normal = f.pixel(aov::normal, x, y);
+                const float* depth = f.pixel(aov::depth, x, y);
+
+                a.r[p] = beauty[0] / std::max(albedo[0], eps);
+                a.g[p] = beauty[1] / std::max(albedo[1], eps);
+                a.b[p] = beauty[2] / std::max(albedo[2], eps);
+                float albedo_lum = std::max(luminance(albedo[0], albedo[1], albedo[2]), eps);
+                a.var[p] = variance[p] / (albedo_lum * albedo_lum);
+
+                float len = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                float inv_len = len > 0 ? 1.0f / len : 0.0f;
+                a.nx[p] = normal[0] * inv_len;
+                a.ny[p] = normal[1] * inv_len;
+                a.nz[p] = normal[2] * inv_len;
+                a.depth[p] = depth[0];
+                a.hit[p] = normal[3] > 0 ? 1.0f : 0.0f;
+            }
+        });
+
+        // Depth gradient: the larger central difference along x and y, over neighbours that hit as well
+        pool.parallel_for(h, [&](int y, int) {
+            for (int x = 0; x < w; x++) {
+                const size_t p = static_cast<size_t>(y) * w + x;
+                float grad = 0;
+                if (x > 0 && x + 1 < w && a.hit[p - 1] > 0 && a.hit[p + 1] > 0) {
+                    grad = std::max(grad, std::fabs(a.depth[p + 1] - a.depth[p - 1]) / 2);
+                }
+                if (y > 0 && y + 1 < h && a.hit[p - w] > 0 && a.hit[p + w] > 0) {
+                    grad = std::max(grad, std::fabs(a.depth[p + w] - a.depth[p - w]) / 2);
+                }
+                a.depth_grad[p] = grad;
+            }
+        });
+        b.nx = a.nx;
+        b.ny = a.ny;
+        b.nz = a.nz;
+        b.depth = a.depth;
+        b.depth_grad = a.depth_grad;
+        b.hit = a.hit;
+
+        std::vector<float> noise(static_cast<size_t>(w) * h);
+        planes* src = &a;
+        planes* dst = &b;
+        for (int pass = 0; pass < settings.passes; pass++) {
+            estimate_noise(*src, noise, pool);
+            atrous_pass(*src, *dst, noise, 1 << pass, settings, pool);
+            std::swap(src, dst);
+        }
+
+        // Remodulate
+        pool.parallel_for(h, [&](int y, int) {
+            for (int x = 0; x < w; x++) {
+                const size_t p = static_cast<size_t>(y) * w + x;
+                if (src->hit[p] == 0) {
+                    continue;
+                }
+                float* beauty = f.pixel(aov::beauty, x, y);
+                const float* albedo = f.pixel(aov::albedo, x, y);
+                beauty[0] = src->r[p] * std::max(albedo[0], eps);
+                beauty[1] = src->g[p] * std::max(albedo[1], eps);
+                beauty[2] = src->b[p] * std::max(albedo[2], eps);
+            }
+        });
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include <vector>
+#include "film.h"
+#include "thread_pool.h"
+
+/*
+    Edge-avoiding a-trous wavelet denoiser (Dammertz et al. 2010) with the variance-guided luminance weight of
+    SVGF (Schied et al. 2017), run on the HDR film after rendering.
+
+    The beauty plane is divided by the first-hit albedo so that textures stay sharp, filtered by a 5x5 B3-spline
+    kernel whose taps are spread 1, 2, 4, ... pixels apart in successive passes, and multiplied back. Every tap is
+    weighted by how close its normal, depth and luminance are to the center's; the luminance is compared in units
+    of the center's noise, estimated from the per-pixel sample variance and carried through the passes.
+
+    Pixels are processed in planar (SoA) rows with straight-line loops over x for each tap, so the weights
+    vectorize; rows are spread over the thread pool.
+*/
+
+struct denoise_settings {
+    int     passes          = 5;        // Tap spacing doubles every pass: 5 passes reach 2 * (1 + 2 + 4 + 8 + 16) = 62 pixels
+    float   sigma_luminance = 4;        // Luminance differences tolerated, in standard deviations of the noise
+    float   sigma_depth     = 1;        // Depth differences tolerated, relative to the local depth gradient
+};
+
+namespace denoise {
+    // Filters the beauty plane of f in place. variance holds, per pixel, the variance of the beauty luminance mean.
+    // Needs the albedo, normal and depth planes; pixels whose samples all missed the scene are left unchanged.
+    void atrous(film& f, const std::vector<float>& variance, thread_pool& pool, const denoise_settings& settings = denoise_settings());
+}
+
+#endif
@@ -0,0 +1,364 @@
+#include "distributed.h"
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <cstring>
+#include "net.h"
+
+namespace {
+    enum class message_type : uint32_t {
+        scene = 1,
+        request,
+        tile,
+        result,
+        done
+    };
+
+    struct message_header {
+        uint32_t type;
+        uint32_t size;
+    };
+
+    // Refuse anything larger than a 4096 x 4096 tile of results with AOVs (52 bytes per pixel)
+    constexpr uint32_t max_payload = 4096u * 4096u * 52u;
+
+    // Tiles are split this finely on the rendering side so that every thread of the pool gets work
+    constexpr int split_size = 8;
+
+    // AOV sums per pixel in a result (see tile_samples)
+    constexpr size_t aov_values = 8;
+
+    template <class T>
+    void put(std::vector<char>& out, const T& value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <class T>
+    void put_array(std::vector<char>& out, const std::vector<T>& values) {
+        const char* bytes = reinterpret_cast<const char*>(values.data());
+        out.insert(out.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    // Reads from a payload, failing instead of overrunning it
+    struct reader {
+        const std::vector<char>&    data;
+        size_t                      offset = 0;
+
+        template <class T>
+        bool get(T& value) {
+            if (offset + sizeof(T) > data.size()) {
+                return false;
+            }
+            std::memcpy(&value, data.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        template <class T>
+        bool get_array(std::vector<T>& values, size_t count) {
+            if (offset + count * sizeof(T) > data.size()) {
+                return false;
+            }
+            values.resize(count);
+            std::memcpy(values.data(), data.data() + offset, count * sizeof(T));
+            offset += count * sizeof(T);
+            return true;
+        }
+
+        std::string rest() const {
+            return std::string(data.begin() + offset, data.end());
+        }
+    };
+
+    bool send_message(net::socket_t s, message_type type, const std::vector<char>& payload = {}) {
+        message_header header = {static_cast<uint32_t>(type), static_cast<uint32_t>(payload.size())};
+        return net::send_all(s, &header, sizeof(header)) && (payload.empty() || net::send_all(s, payload.data(), payload.size()));
+    }
+
+    bool recv_message(net::socket_t s, message_type& type, std::vector<char>& payload) {
+        message_header header;
+        if (!net::recv_all(s, &header, sizeof(header)) || header.size > max_payload) {
+            return false;
+        }
+        type = static_cast<message_type>(header.type);
+        payload.resize(header.size);
+        return header.size == 0 || net::recv_all(s, payload.data(), header.size);
+    }
+
+    std::vector<char> encode_tile(const tile& t, int spp) {
+        std::vector<char> payload;
+        put<int32_t>(payload, t.x0); put<int32_t>(payload, t.y0);
+        put<int32_t>(payload, t.x1); put<int32_t>(payload, t.y1);
+        put<int32_t>(payload, spp);
+        return payload;
+    }
+
+    std::vector<char> encode_result(const tile_samples& samples) {
+        std::vector<char> payload;
+        const auto& t = samples.bounds;
+        put<int32_t>(payload, t.x0); put<int32_t>(payload, t.y0);
+        put<int32_t>(payload, t.x1); put<int32_t>(payload, t.y1);
+        put_array(payload, samples.rgb);
+        put_array(payload, samples.lum_sq);
+        put_array(payload, samples.spp);
+        put_array(payload, samples.aov);
+        return payload;
+    }
+
+    bool decode_result(const std::vector<char>& payload, tile_samples& samples) {
+        reader in{payload};
+        int32_t x0, y0, x1, y1;
+        if (!in.get(x0) || !in.get(y0) || !in.get(x1) || !in.get(y1)) {
+            return false;
+        }
+        samples.bounds = {x0, y0, x1, y1};
+        size_t n = samples.bounds.empty() ? 0 : static_cast<size_t>(samples.bounds.pixel_count());
+        if (!in.get_array(samples.rgb, n * 3) || !in.get_array(samples.lum_sq, n) || !in.get_array(samples.spp, n)) {
+            return false;
+        }
+        // AOV sums follow when the frame collects them
+        samples.aov.clear();
+        return in.offset == payload.size() || in.get_array(samples.aov, n * aov_values);
+    }
+
+    // Splits a tile into sub-tiles of split_size pixels
+    std::vector<tile> split(const tile& t, int width, int height) {
+        return clip_tiles(make_tiles(width, height, split_size, tile_order::scanline), t);
+    }
+
+    // Tiles waiting to be rendered, and how many are merged
+    struct tile_board {
+        std::mutex              lock;
+        std::condition_variable changed;
+        std::deque<int>         pending;
+        int                     merged          = 0;
+        int                     total           = 0;
+        int                     merged_remote   = 0;
+
+        // Blocks until a tile is free (true) or every tile is merged (false)
+        bool take(int& index) {
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [&] { return !pending.empty() || merged == total; });
+            if (pending.empty()) {
+                return false;
+            }
+            index = pending.front();
+            pending.pop_front();
+            return true;
+        }
+
+        void give_back(int index) {
+            std::lock_guard<std::mutex> guard(lock);
+            pending.push_front(index);
+            changed.notify_all();
+        }
+    };
+}
+
+namespace distributed {
+    bool coordinate(camera& cam, const scene_desc& desc, const distributed_options& options) {
+        if (!net::startup()) {
+            std::cerr << "Distributed: sockets unavailable\n";
+            return false;
+        }
+        net::socket_t listener = net::listen_on(options.port, options.loopback_only);
+        if (listener == net::invalid_socket) {
+            std::cerr << "Distributed: cannot listen on port " << options.port << '\n';
+            return false;
+        }
+
+        const auto& s = desc.settings;
+        world w = scene::build_world(desc);
+        cam.set_seed(options.seed);
+        cam.set_progress_log(false);
+        cam.set_engine(static_cast<render_engine>(s.engine));
+        cam.set_light_sampling(s.light_sampling);
+        cam.begin_frame(w, s.camera_position, s.lookat);
+
+        const bool jitter = s.aa_factor != 1;
+        const int spp = std::max(1, s.aa_factor);
+        const auto tiles = make_tiles(s.width, s.height, options.tile_size, tile_order::morton);
+        const std::string scene_text = scene::to_text(desc);
+
+        tile_board board;
+        board.total = static_cast<int>(tiles.size());
+        for (int t = 0; t < board.total; t++) {
+            board.pending.push_back(t);
+        }
+
+        auto report = [&]() {
+            std::clog << "\rTiles merged: " << board.merged << " / " << board.total << "    " << std::flush;
+        };
+
+        // One thread per worker connection: hand out tiles, merge what comes back
+        auto serve = [&](net::socket_t conn) {
+            std::vector<char> hello;
+            put<uint64_t>(hello, options.seed);
+            put<int32_t>(hello, split_size);
+            put<int32_t>(hello, cam.collects_aovs() ? 1 : 0);
+            hello.insert(hello.end(), scene_text.begin(), scene_text.end());
+            if (!send_message(conn, message_type::scene, hello)) {
+                net::close_socket(conn);
+                return;
+            }
+
+            message_type type;
+            std::vector<char> payload;
+            while (recv_message(conn, type, payload) && type == message_type::request) {
+                int index;
+                if (!board.take(index)) {
+                    send_message(conn, message_type::done);
+                    break;
+                }
+
+                tile_samples result;
+                if (!send_message(conn, message_type::tile, encode_tile(tiles[index], spp))
+                    || !recv_message(conn, type, payload) || type != message_type::result
+                    || !decode_result(payload, result) || result.bounds.x0 != tiles[index].x0 || result.bounds.y0 != tiles[index].y0
+                    || result.bounds.x1 != tiles[index].x1 || result.bounds.y1 != tiles[index].y1) {
+                    board.give_back(index);
+                    break;
+                }
+
+                std::lock_guard<std::mutex> guard(board.lock);
+                cam.import_tile(result);
+                board.merged++;
+                board.merged_remote++;
+                report();
+                board.changed.notify_all();
+            }
+            net::close_socket(conn);
+        };
+
+        std::mutex connections_lock;
+        std::vector<std::thread> connections;
+        std::thread acceptor([&]() {
+            while (true) {
+                net::socket_t conn = net::accept_from(listener);
+                if (conn == net::invalid_socket) {
+                    break;
+                }
+                std::lock_guard<std::mutex> guard(connections_lock);
+                connections.emplace_back(serve, conn);
+            }
+        });
+
+        auto start = std::chrono::steady_clock::now();
+        const char* kernel_name = "distributed";
+        if (options.render_locally) {
+            // Local tiles are rendered straight into the camera; remote merges only ever touch other tiles
+            int index;
+            while (board.take(index)) {
+                kernel_name = cam.render_tiles(split(tiles[index], s.width, s.height), spp, jitter);
+
+                std::lock_guard<std::mutex> guard(board.lock);
+                board.merged++;
+                report();
+                board.changed.notify_all();
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> guard(board.lock);
+            board.changed.wait(guard, [&] { return board.merged == board.total; });
+        }
+
+        // Idle workers have been told they are done; stop accepting and wait for the connections to wind down
+        net::close_socket(listener);
+        acceptor.join();
+        for (auto& c : connections) {
+            c.join();
+        }
+
+        cam.set_progress_log(true);
+        cam.resolve();
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        cam.log_render(kernel_name, elapsed);
+        std::clog << "Distributed: " << board.total << " tiles, " << board.merged_remote << " rendered by "
+                  << connections.size() << " worker connection(s)\n";
+        return true;
+    }
+
+    bool work(const std::string& host, int port) {
+        if (!net::startup()) {
+            std::cerr << "Worker: sockets unavailable\n";
+            return false;
+        }
+        net::socket_t conn = net::connect_to(host, port);
+        if (conn == net::invalid_socket) {
+            std::cerr << "Worker: cannot connect to " << host << ':' << port << '\n';
+            return false;
+        }
+
+        message_type type;
+        std::vector<char> payload;
+        uint64_t seed;
+        int32_t split, aovs;
+        reader hello{payload};
+        if (!recv_message(conn, type, payload) || type != message_type::scene || !hello.get(seed) || !hello.get(split) || !hello.get(aovs)
+            || split <= 0) {
+            std::cerr << "Worker: no scene received\n";
+            net::close_socket(conn);
+            return false;
+        }
+
+        // Same world, camera and seed as the coordinator. A scene this build cannot read (malformed, or from a newer
+        // version) ends this worker's session rather than the process.
+        scene_desc desc;
+        world scene_world;
+        try {
+            desc = scene::from_text(hello.rest());
+            scene_world = scene::build_world(desc);
+        } catch (const std::exception& e) {
+            std::cerr << "Worker: cannot use the scene: " << e.what() << '\n';
+            net::close_socket(conn);
+            return false;
+        }
+        const auto& s = desc.settings;
+        std::vector<unsigned char> image(static_cast<size_t>(s.width) * s.height * 3);
+        camera cam(s.width, s.height, image, s.fov, s.dof_angle, s.background, s.aa_factor, s.max_depth);
+        cam.set_seed(seed);
+        cam.set_progress_log(false);
+        cam.set_engine(static_cast<render_engine>(s.engine));
+        cam.set_light_sampling(s.light_sampling);
+        // The coordinator's denoiser needs the AOVs of every tile
+        cam.set_aovs(aovs != 0);
+        cam.begin_frame(scene_world, s.camera_position, s.lookat);
+
+        int rendered = 0;
+        bool ok = true;
+        while (true) {
+            if (!send_message(conn, message_type::request) || !recv_message(conn, type, payload)) {
+                ok = false;
+                break;
+            }
+            if (type == message_type::done) {
+                break;
+            }
+
+            reader in{payload};
+            int32_t x0, y0, x1, y1, spp;
+            if (type != message_type::tile || !in.get(x0) || !in.get(y0) || !in.get(x1) || !in.get(y1) || !in.get(spp)) {
+                ok = false;
+                break;
+            }
+
+            tile t = intersect({x0, y0, x1, y1}, {0, 0, s.width, s.height});
+            cam.render_tiles(clip_tiles(make_tiles(s.width, s.height, split, tile_order::scanline), t), spp, s.aa_factor != 1);
+
+            tile_samples result;
+            cam.export_tile({x0, y0, x1, y1}, result);
+            if (!send_message(conn, message_type::result, encode_result(result))) {
+                ok = false;
+                break;
+            }
+            rendered++;
+        }
+
+        net::close_socket(conn);
+        std::clog << "\nWorker: " << rendered << " tiles rendered" << (ok ? "" : ", connection lost") << '\n';
+        return ok;
+    }
+}
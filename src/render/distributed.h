@@ -0,0 +1,50 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <string>
+#include <cstdint>
+#include "../env.h"
+#include "../scene/scene.h"
+
+/*
+    Tile-distributed rendering over TCP. A coordinator owns the frame and hands out tiles on request;
+    worker processes (on this machine or on other hosts) receive the scene file, pull tiles, render them
+    and send back the accumulated float sums, which the coordinator merges. Every pixel sample is seeded
+    from its pixel and sample number (camera::set_seed), so the merged image does not depend on which
+    worker rendered which tile.
+
+    Messages are a {uint32 type, uint32 payload size} header plus payload, in host byte order
+    (all machines must share endianness):
+
+        coordinator -> worker   scene       uint64 seed, int32 tile split size, int32 AOVs collected (0 or 1),
+                                            scene text
+        worker -> coordinator   request     (empty)
+        coordinator -> worker   tile        int32 x0, y0, x1, y1, spp
+        worker -> coordinator   result      int32 x0, y0, x1, y1, then per pixel 3 float radiance sums,
+                                            float squared luminance sum, int32 sample count, then
+                                            (when AOVs are collected) 8 float AOV sums per pixel
+        coordinator -> worker   done        (empty)
+
+    A worker that disconnects mid-tile has its tile handed out again. Remote tiles carry their AOVs, so the
+    coordinator denoises the merged frame as it would a local one.
+*/
+
+struct distributed_options {
+    int         port            = 5555;
+    bool        loopback_only   = false;    // Accept workers from this machine only
+    bool        render_locally  = true;     // The coordinator renders tiles as well; without it the render waits for workers
+    int         tile_size       = 32;       // Unit of work handed to a worker
+    uint64_t    seed            = 0;
+};
+
+namespace distributed {
+    // Renders the scene into cam, which must have been built with the scene's settings, together with every worker
+    // that connects before the last tile is merged. Returns false when the port cannot be opened.
+    bool    coordinate(camera& cam, const scene_desc& scene, const distributed_options& options);
+
+    // Connects to a coordinator and renders the tiles it hands out until it reports done.
+    // Returns false on connection or protocol errors.
+    bool    work(const std::string& host, int port);
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "film.h"
+
+const char* aov_name(aov plane) {
+    switch (plane) {
+        case aov::beauty:       return "beauty";
+        case aov::albedo:       return "albedo";
+        case aov::normal:       return "normal";
+        case aov::depth:        return "depth";
+        case aov::sample_count: return "sample count";
+        default:                return "unknown";
+    }
+}
+
+void film::resize(int width_, int height_, bool with_aovs) {
+    width = width_;
+    height = height_;
+
+    const size_t floats = static_cast<size_t>(width) * height * 4;
+    for (int p = 0; p < static_cast<int>(aov::count); p++) {
+        bool wanted = p == static_cast<int>(aov::beauty) || with_aovs;
+        if (wanted) {
+            planes[p].resize(floats);
+        } else {
+            planes[p].clear();
+            planes[p].shrink_to_fit();
+        }
+    }
+}
+
+int film::get_width() const {
+    return width;
+}
+
+int film::get_height() const {
+    return height;
+}
+
+bool film::has(aov plane) const {
+    return !planes[static_cast<int>(plane)].empty();
+}
+
+float* film::pixel(aov plane, int i, int j) {
+    return planes[static_cast<int>(plane)].data() + (static_cast<size_t>(j) * width + i) * 4;
+}
+
+const float* film::pixel(aov plane, int i, int j) const {
+    return planes[static_cast<int>(plane)].data() + (static_cast<size_t>(j) * width + i) * 4;
+}
+
+const std::vector<float>& film::data(aov plane) const {
+    return planes[static_cast<int>(plane)];
+}
@@ -0,0 +1,48 @@
+#ifndef FILM_H
+#define FILM_H
+
+#include <vector>
+#include "../color.h"
+
+// Planes of the film. Every plane is a row-major float RGBA image of the same size.
+enum class aov {
+    beauty,         // Mean radiance, alpha 1. Unbounded: values above 1 are kept for tone mapping.
+    albedo,         // Mean first-hit albedo (background color for misses), alpha = fraction of samples that hit
+    normal,         // Mean first-hit world space normal, alpha = hit fraction
+    depth,          // Mean first-hit distance over the samples that hit, in R, G and B; alpha = hit fraction
+    sample_count,   // Samples taken by the pixel, in R, G and B
+    count
+};
+
+const char* aov_name(aov plane);
+
+// First-hit data of one camera sample, gathered by the integrators for the AOV planes
+struct aov_sample {
+    color   albedo  = color(0, 0, 0);
+    vec3    normal  = vec3(0, 0, 0);
+    Real    depth   = 0;
+    bool    hit     = false;
+};
+
+// HDR render target: the beauty plane plus optional AOV planes
+class film {
+    public:
+        // Allocates the beauty plane and, with_aovs, the AOV planes. Contents are undefined until written.
+        void    resize(int width_, int height_, bool with_aovs);
+
+        int     get_width() const;
+        int     get_height() const;
+        bool    has(aov plane) const;
+
+        // RGBA floats of the pixel (i, j)
+        float*          pixel(aov plane, int i, int j);
+        const float*    pixel(aov plane, int i, int j) const;
+        const std::vector<float>& data(aov plane) const;
+
+    private:
+        int                 width   = 0;
+        int                 height  = 0;
+        std::vector<float>  planes[static_cast<int>(aov::count)];
+};
+
+#endif
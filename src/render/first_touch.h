@@ -0,0 +1,36 @@
+#ifndef FIRST_TOUCH_H
+#define FIRST_TOUCH_H
+
+#include <memory>
+#include <cstddef>
+
+/*
+    Array of plain values that is allocated without being written. The OS places a page on the NUMA node of
+    the thread that first writes it, so whoever initializes the array decides where its memory lives;
+    std::vector would zero it (and pull every page to one node) on the allocating thread.
+*/
+
+template <class T>
+class first_touch_array {
+    public:
+        // Uninitialized storage for count values. Keeps the current storage if the size does not change.
+        void allocate(size_t count) {
+            if (count != length) {
+                values.reset(count ? new T[count] : nullptr);
+                length = count;
+            }
+        }
+
+        T&          operator[](size_t i)        { return values[i]; }
+        const T&    operator[](size_t i) const  { return values[i]; }
+        T*          data()                      { return values.get(); }
+        const T*    data() const                { return values.get(); }
+        size_t      size() const                { return length; }
+        bool        empty() const               { return length == 0; }
+
+    private:
+        std::unique_ptr<T[]>    values;
+        size_t                  length  = 0;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#include "framebuffer.h"
+#include <algorithm>
+
+frame& framebuffer::back() {
+    return slots[back_index];
+}
+
+void framebuffer::publish() {
+    slots[back_index].serial = ++published;
+
+    // Hand the finished slot over and take whatever the middle held, read or not
+    int previous = middle.exchange(back_index | fresh_bit, std::memory_order_acq_rel);
+    back_index = previous & ~fresh_bit;
+}
+
+void framebuffer::publish(const std::vector<unsigned char>& rgb, int width, int height) {
+    auto& target = back();
+    target.width = width;
+    target.height = height;
+    target.pixels.resize(static_cast<size_t>(width) * height * 3);
+    std::copy_n(rgb.begin(), std::min(rgb.size(), target.pixels.size()), target.pixels.begin());
+    publish();
+}
+
+bool framebuffer::acquire() {
+    if (!(middle.load(std::memory_order_relaxed) & fresh_bit)) {
+        return false;
+    }
+
+    int previous = middle.exchange(front_index, std::memory_order_acq_rel);
+    front_index = previous & ~fresh_bit;
+    return true;
+}
+
+const frame& framebuffer::front() const {
+    return slots[front_index];
+}
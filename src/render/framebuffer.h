@@ -0,0 +1,50 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <atomic>
+#include <vector>
+
+// One displayable 8-bit RGB image
+struct frame {
+    int                         width   = 0;
+    int                         height  = 0;
+    unsigned long long          serial  = 0;    // Increases with every publish
+    std::vector<unsigned char>  pixels;
+};
+
+/*
+    Lock-free triple buffer between one producer (the renderer) and one consumer (the UI).
+    The producer writes into back() and publishes it; the consumer calls acquire() and reads front().
+    Neither side ever waits: each owns one slot outright and the third is swapped with a single atomic exchange.
+    Every slot carries its own size, so the image can change size between publishes.
+*/
+
+class framebuffer {
+    public:
+        framebuffer() = default;
+
+        framebuffer(const framebuffer&) = delete;
+        framebuffer& operator=(const framebuffer&) = delete;
+
+        // Producer side
+        frame&          back();
+        void            publish();
+        // Copies an RGB image into the back slot and publishes it
+        void            publish(const std::vector<unsigned char>& rgb, int width, int height);
+
+        // Consumer side. Returns true when a newer frame was swapped in.
+        bool            acquire();
+        const frame&    front() const;
+
+    private:
+        // Slot index in the low bits, plus a flag telling that the middle slot holds an unread frame
+        static constexpr int fresh_bit = 4;
+
+        frame               slots[3];
+        int                 back_index  = 0;
+        int                 front_index = 1;
+        std::atomic<int>    middle{2};
+        unsigned long long  published   = 0;
+};
+
+#endif
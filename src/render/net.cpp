@@ -0,0 +1,159 @@
+#include "net.h"
+#include <mutex>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    using native_socket = SOCKET;
+    const native_socket native_invalid = INVALID_SOCKET;
+    using io_size = int;
+#else
+    using native_socket = int;
+    const native_socket native_invalid = -1;
+    using io_size = size_t;
+#endif
+
+#ifdef MSG_NOSIGNAL
+    const int send_flags = MSG_NOSIGNAL;    // A vanished peer is an error to handle, not a SIGPIPE
+#else
+    const int send_flags = 0;
+#endif
+
+    native_socket native(net::socket_t s) {
+        return static_cast<native_socket>(s);
+    }
+
+    net::socket_t wrap(native_socket s) {
+        return s == native_invalid ? net::invalid_socket : static_cast<net::socket_t>(s);
+    }
+
+    void set_no_delay(native_socket s) {
+        // Requests and tiles are small messages; do not hold them back for coalescing
+        int on = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+    }
+}
+
+namespace net {
+    bool startup() {
+#ifdef _WIN32
+        static std::once_flag once;
+        static bool ok = false;
+        std::call_once(once, [] {
+            WSADATA data;
+            ok = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        });
+        return ok;
+#else
+        return true;
+#endif
+    }
+
+    socket_t listen_on(int port, bool loopback_only) {
+        native_socket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (s == native_invalid) {
+            return invalid_socket;
+        }
+
+        int on = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<unsigned short>(port));
+        addr.sin_addr.s_addr = htonl(loopback_only ? INADDR_LOOPBACK : INADDR_ANY);
+        if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(s, 16) != 0) {
+            close_socket(wrap(s));
+            return invalid_socket;
+        }
+        return wrap(s);
+    }
+
+    socket_t accept_from(socket_t listener) {
+        native_socket s = accept(native(listener), nullptr, nullptr);
+        if (s != native_invalid) {
+            set_no_delay(s);
+        }
+        return wrap(s);
+    }
+
+    socket_t connect_to(const std::string& host, int port) {
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* found = nullptr;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) != 0) {
+            return invalid_socket;
+        }
+
+        native_socket s = native_invalid;
+        for (addrinfo* a = found; a; a = a->ai_next) {
+            s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (s == native_invalid) {
+                continue;
+            }
+            if (connect(s, a->ai_addr, static_cast<int>(a->ai_addrlen)) == 0) {
+                break;
+            }
+            close_socket(wrap(s));
+            s = native_invalid;
+        }
+        freeaddrinfo(found);
+
+        if (s != native_invalid) {
+            set_no_delay(s);
+        }
+        return wrap(s);
+    }
+
+    bool send_all(socket_t s, const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            auto sent = send(native(s), bytes, static_cast<io_size>(size), send_flags);
+            if (sent <= 0) {
+                return false;
+            }
+            bytes += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    bool recv_all(socket_t s, void* data, size_t size) {
+        char* bytes = static_cast<char*>(data);
+        while (size > 0) {
+            auto got = recv(native(s), bytes, static_cast<io_size>(size), 0);
+            if (got <= 0) {
+                return false;
+            }
+            bytes += got;
+            size -= static_cast<size_t>(got);
+        }
+        return true;
+    }
+
+    void close_socket(socket_t s) {
+        if (s == invalid_socket) {
+            return;
+        }
+#ifdef _WIN32
+        shutdown(native(s), SD_BOTH);
+        closesocket(native(s));
+#else
+        shutdown(native(s), SHUT_RDWR);
+        close(native(s));
+#endif
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef NET_H
+#define NET_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/*
+    Minimal blocking TCP sockets over Winsock (Windows) or BSD sockets (everywhere else).
+    Only what the distributed renderer needs: listen, accept, connect and whole-buffer send/receive.
+*/
+
+namespace net {
+    using socket_t = std::uintptr_t;
+    constexpr socket_t invalid_socket = static_cast<socket_t>(-1);
+
+    // Initializes the socket library once per process. Returns false if it is unavailable.
+    bool        startup();
+
+    // Listens on the port, on 127.0.0.1 only when loopback_only is set
+    socket_t    listen_on(int port, bool loopback_only);
+    // Blocks until a connection comes in; invalid_socket once the listener is closed
+    socket_t    accept_from(socket_t listener);
+    socket_t    connect_to(const std::string& host, int port);
+
+    // Send or receive exactly size bytes. False on error or when the peer closed the connection.
+    bool        send_all(socket_t s, const void* data, size_t size);
+    bool        recv_all(socket_t s, void* data, size_t size);
+
+    // Shuts the socket down (which also wakes a thread blocked in accept_from) and closes it
+    void        close_socket(socket_t s);
+}
+
+#endif
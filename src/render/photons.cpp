@@ -0,0 +1,253 @@
+#include "photons.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <cmath>
+#include "../sampling/warp.h"
+
+namespace {
+    // Photons are traced in this many batches whatever the pool size, so the map does not depend on the thread count
+    constexpr int batches = 256;
+
+    // Cone filter (Jensen 2001, k = 1): weight 1 - d / r, normalized over the disk by 1 - 2 / 3
+    constexpr Real cone_normalization = 1 - Real(2) / 3;
+}
+
+void photon_map::clear() {
+    photons.clear();
+    slot_start.clear();
+    slot_mask = 0;
+    photons_emitted = 0;
+}
+
+bool photon_map::empty() const {
+    return photons.empty();
+}
+
+size_t photon_map::size() const {
+    return photons.size();
+}
+
+long long photon_map::emitted() const {
+    return photons_emitted;
+}
+
+const photon_settings& photon_map::get_settings() const {
+    return settings;
+}
+
+int64_t photon_map::cell_of(Real coordinate) const {
+    return static_cast<int64_t>(std::floor(coordinate / cell_size));
+}
+
+uint32_t photon_map::slot_of(int64_t cx, int64_t cy, int64_t cz) const {
+    // Teschner et al. 2003 spatial hash
+    uint64_t h = (static_cast<uint64_t>(cx) * 73856093u) ^ (static_cast<uint64_t>(cy) * 19349663u) ^ (static_cast<uint64_t>(cz) * 83492791u);
+    return static_cast<uint32_t>(h) & slot_mask;
+}
+
+void photon_map::build(objs& scene, const photon_settings& settings_, thread_pool& pool, uint64_t seed) {
+    clear();
+    settings = settings_;
+    cell_size = 2 * settings.radius;
+
+    // Emitters are picked by power
+    std::vector<const objs*> emitters;
+    scene.collect_emitters(emitters);
+    std::vector<Real> cdf;
+    Real total_power = 0;
+    for (const objs* e : emitters) {
+        total_power += std::fmax(Real(0), e->get_emitter_bounds().power);
+        cdf.push_back(total_power);
+    }
+    if (emitters.empty() || total_power <= 0 || settings.photons <= 0 || settings.radius <= 0) {
+        return;
+    }
+    photons_emitted = settings.photons;
+
+    // Trace: every batch keeps its own photons
+    std::vector<std::vector<photon>> traced(batches);
+    pool.parallel_for(batches, [&](int b, int) {
+        utils::seed_random(utils::hash_seed(seed, static_cast<uint64_t>(b), 0x70686f746f6eull));
+        const int count = settings.photons / batches + (b < settings.photons % batches ? 1 : 0);
+        auto& out = traced[b];
+
+        for (int i = 0; i < count; i++) {
+            Real u = utils::random_double(0, 1) * total_power;
+            int e = std::min(static_cast<int>(std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin()), static_cast<int>(emitters.size()) - 1);
+            Real pmf = (cdf[e] - (e > 0 ? cdf[e - 1] : 0)) / total_power;
+            Real u1 = utils::random_double(0, 1);
+            Real u2 = utils::random_double(0, 1);
+            emitter_sample s = emitters[e]->sample_area(u1, u2);
+            if (s.pdf <= 0 || pmf <= 0) {
+                continue;
+            }
+
+            // Cosine-weighted emission: the cosine of the radiance cancels against the direction's density, leaving pi
+            warp::onb frame(s.normal);
+            Real u3 = utils::random_double(0, 1);
+            Real u4 = utils::random_double(0, 1);
+            ray r(s.point, frame.to_world(warp::square_to_cosine_hemisphere(u3, u4)));
+            color power = emitters[e]->get_material()->emit(s.point) * (M_PI / (pmf * s.pdf * settings.photons));
+
+            // Follow specular bounces only; the first surface with a density ends the photon
+            bool through_specular = false;
+            for (int bounce = 0; bounce <= settings.max_bounces; bounce++) {
+                hit_history hist;
+                if (!scene.ray_hit(r, 1e-4, std::numeric_limits<Real>::infinity(), hist)) {
+                    break;
+                }
+                const material* mat = hist.material_.get();
+                if (mat->is_emissive()) {
+                    break;
+                }
+                if (mat->has_density()) {
+                    if (through_specular) {
+                        vec3 from = r.get_direction().unit_vector() * -1;
+                        out.push_back({static_cast<float>(hist.intersection.x()), static_cast<float>(hist.intersection.y()),
+                                       static_cast<float>(hist.intersection.z()), static_cast<float>(from.x()),
+                                       static_cast<float>(from.y()), static_cast<float>(from.z()), static_cast<float>(power.x()),
+                                       static_cast<float>(power.y()), static_cast<float>(power.z())});
+                    }
+                    break;
+                }
+                if (bounce == settings.max_bounces) {
+                    break;
+                }
+
+                auto bs = mat->sample(r, hist.normal, hist.intersection, hist.is_front, hist.u, hist.v);
+                if (!bs.specular) {
+                    break;
+                }
+                // Russian roulette on the bounce's weight keeps the photons' powers even
+                Real survive = std::fmin(max_component(bs.weight), Real(1));
+                if (!(survive > 0) || utils::random_double(0, 1) >= survive) {
+                    break;
+                }
+                power = hadamard(power, bs.weight) / survive;
+                through_specular = true;
+                r = bs.scattered;
+            }
+        }
+    });
+
+    // Concatenate in batch order
+    std::vector<size_t> offset(batches + 1, 0);
+    for (int b = 0; b < batches; b++) {
+        offset[b + 1] = offset[b] + traced[b].size();
+    }
+    const size_t n = offset[batches];
+    if (n == 0) {
+        return;
+    }
+    std::vector<photon> unsorted(n);
+    pool.parallel_for(batches, [&](int b, int) {
+        std::copy(traced[b].begin(), traced[b].end(), unsorted.begin() + offset[b]);
+    });
+
+    // Counting sort into slots: about two slots per photon keeps collisions between cells rare
+    uint32_t slots = 1024;
+    while (slots < 2 * n && slots < (1u << 30)) {
+        slots <<= 1;
+    }
+    slot_mask = slots - 1;
+    const int chunks = std::min<int>(batches, static_cast<int>(n));
+    auto chunk_range = [&](int c, size_t& lo, size_t& hi) {
+        lo = n * c / chunks;
+        hi = n * (c + 1) / chunks;
+    };
+
+    std::vector<uint32_t> slot(n);
+    std::unique_ptr<std::atomic<uint32_t>[]> counts(new std::atomic<uint32_t>[slots]);
+    for (uint32_t s = 0; s < slots; s++) {
+        counts[s].store(0, std::memory_order_relaxed);
+    }
+    pool.parallel_for(chunks, [&](int c, int) {
+        size_t lo, hi;
+        chunk_range(c, lo, hi);
+        for (size_t i = lo; i < hi; i++) {
+            const photon& p = unsorted[i];
+            slot[i] = slot_of(cell_of(p.x), cell_of(p.y), cell_of(p.z));
+            counts[slot[i]].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    slot_start.assign(static_cast<size_t>(slots) + 1, 0);
+    for (uint32_t s = 0; s < slots; s++) {
+        slot_start[s + 1] = slot_start[s] + counts[s].load(std::memory_order_relaxed);
+        counts[s].store(slot_start[s], std::memory_order_relaxed);
+    }
+
+    std::vector<uint32_t> order(n);
+    pool.parallel_for(chunks, [&](int c, int) {
+        size_t lo, hi;
+        chunk_range(c, lo, hi);
+        for (size_t i = lo; i < hi; i++) {
+            order[counts[slot[i]].fetch_add(1, std::memory_order_relaxed)] = static_cast<uint32_t>(i);
+        }
+    });
+
+    // Scatter order within a slot depends on the threads' timing: sort each slot back on its own (a sort across
+    // slot boundaries would move photons into their neighbours' slots), then gather
+    photons.resize(n);
+    const uint32_t slots_per_chunk = (slots + batches - 1) / batches;
+    pool.parallel_for(batches, [&](int c, int) {
+        uint32_t first = std::min(slots, c * slots_per_chunk);
+        uint32_t last = std::min(slots, first + slots_per_chunk);
+        for (uint32_t s = first; s < last; s++) {
+            std::sort(order.begin() + slot_start[s], order.begin() + slot_start[s + 1]);
+        }
+        for (uint32_t i = slot_start[first]; i < slot_start[last]; i++) {
+            photons[i] = unsorted[order[i]];
+        }
+    });
+}
+
+color photon_map::estimate(const hit_history& hist) const {
+    const material* mat = hist.material_.get();
+    if (photons.empty() || !mat->has_density()) {
+        return color(0, 0, 0);
+    }
+
+    const vec3& p = hist.intersection;
+    const vec3& n = hist.normal;
+    const Real r = settings.radius;
+    const Real r2 = r * r;
+    const int64_t x_lo = cell_of(p.x() - r), x_hi = cell_of(p.x() + r);
+    const int64_t y_lo = cell_of(p.y() - r), y_hi = cell_of(p.y() + r);
+    const int64_t z_lo = cell_of(p.z() - r), z_hi = cell_of(p.z() + r);
+
+    // Cells are twice the radius wide, so 2x2x2 of them overlap the sphere; when p +- r falls on cell boundaries,
+    // rounding can add a third layer on an axis. Two cells hashing to the same slot must only be read once.
+    uint32_t visited[27];
+    int visited_count = 0;
+    color sum(0, 0, 0);
+    for (int64_t cz = z_lo; cz <= z_hi; cz++) {
+        for (int64_t cy = y_lo; cy <= y_hi; cy++) {
+            for (int64_t cx = x_lo; cx <= x_hi; cx++) {
+                uint32_t s = slot_of(cx, cy, cz);
+                if (std::find(visited, visited + visited_count, s) != visited + visited_count) {
+                    continue;
+                }
+                visited[visited_count++] = s;
+
+                for (uint32_t i = slot_start[s]; i < slot_start[s + 1]; i++) {
+                    const photon& ph = photons[i];
+                    vec3 offset(ph.x - p.x(), ph.y - p.y(), ph.z - p.z());
+                    Real d2 = offset * offset;
+                    vec3 from(ph.wx, ph.wy, ph.wz);
+                    Real cos_theta = from * n;
+                    // Photons off the tangent plane by more than a quarter radius lie on another surface
+                    if (d2 >= r2 || cos_theta <= 0 || std::fabs(offset * n) > r / 4) {
+                        continue;
+                    }
+                    // eval includes the cosine, which the photon's power already accounts for
+                    color f = mat->eval(from, n, hist.u, hist.v, hist.intersection) / cos_theta;
+                    sum += hadamard(f, color(ph.r, ph.g, ph.b)) * (1 - std::sqrt(d2) / r);
+                }
+            }
+        }
+    }
+    return sum / (cone_normalization * M_PI * r2);
+}
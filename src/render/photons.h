@@ -0,0 +1,68 @@
+#ifndef PHOTONS_H
+#define PHOTONS_H
+
+#include <vector>
+#include <cstdint>
+#include "../ray.h"
+#include "../color.h"
+#include "../objects/objs.h"
+#include "thread_pool.h"
+
+/*
+    Caustic photon map (Jensen 1996). Light that reaches a diffuse surface through mirrors and glass (paths
+    L S+ D) is found by camera paths only when they happen to scatter into a small bright emitter through the
+    specular chain, so it stays fireflies at any sample count. Instead, photons are shot from the emitters before
+    rendering, followed through specular bounces only, and stored where they land on a surface with a density;
+    camera paths then estimate that light at each diffuse hit from the photons within a fixed radius.
+
+    Photons are traced in fixed batches over the thread pool, each from its own random stream, and stored in a
+    hashed grid of cells twice the gather radius wide, so a lookup visits 2x2x2 cells. The grid is built
+    in parallel as a counting sort: cell counts with atomic adds, a prefix sum, then an atomic scatter whose
+    per-cell order is restored by sorting on the photon index, so equal seeds give identical maps.
+
+    Emission through a specular chain that camera paths find after a diffuse bounce must be left out by the
+    caller while the map is in use (see camera::ray_color), or it is counted twice.
+*/
+
+struct photon_settings {
+    int     photons     = 200000;       // Emitted per frame; only those reaching a diffuse surface through a specular chain are kept
+    Real    radius      = 0.1;          // Gather radius in scene units
+    int     max_bounces = 8;            // Specular bounces a photon is followed through
+};
+
+class photon_map {
+    public:
+        // Traces the photons of the emitters below scene and builds the grid. The map is empty when no photon got stored.
+        void    build(objs& scene, const photon_settings& settings, thread_pool& pool, uint64_t seed);
+        void    clear();
+
+        bool        empty() const;
+        size_t      size() const;
+        long long   emitted() const;
+        const photon_settings& get_settings() const;
+
+        // Radiance the hit's material reflects from the caustic photons around it. Zero for materials without a density.
+        color   estimate(const hit_history& hist) const;
+
+    private:
+        friend struct photon_map_test;      // tests/photons_test.cpp checks the grid against a brute-force gather
+
+        struct photon {
+            float   x, y, z;
+            float   wx, wy, wz;         // Unit direction the photon arrived from (pointing away from the surface)
+            float   r, g, b;            // Power
+        };
+
+        photon_settings         settings;
+        long long               photons_emitted = 0;
+        std::vector<photon>     photons;            // Sorted by grid slot
+        std::vector<uint32_t>   slot_start;         // Photons of slot s are [slot_start[s], slot_start[s + 1])
+        uint32_t                slot_mask   = 0;
+        Real                    cell_size   = 1;
+
+        // Grid slot of integer cell coordinates
+        uint32_t    slot_of(int64_t cx, int64_t cy, int64_t cz) const;
+        int64_t     cell_of(Real coordinate) const;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "render_job.h"
+#include <limits>
+
+const char* phase_name(render_phase phase) {
+    switch (phase) {
+        case render_phase::preview: return "preview";
+        case render_phase::uniform: return "uniform";
+        case render_phase::refine:  return "refine";
+    }
+    return "unknown";
+}
+
+const char* status_name(render_status status) {
+    switch (status) {
+        case render_status::completed: return "completed";
+        case render_status::deadline:  return "deadline reached";
+        case render_status::budget:    return "sample budget spent";
+        case render_status::cancelled: return "cancelled";
+    }
+    return "unknown";
+}
+
+void render_job::start() {
+    started = std::chrono::steady_clock::now();
+    cancel_requested.store(false, std::memory_order_relaxed);
+}
+
+void render_job::cancel() {
+    cancel_requested.store(true, std::memory_order_relaxed);
+}
+
+bool render_job::cancelled() const {
+    return cancel_requested.load(std::memory_order_relaxed);
+}
+
+double render_job::elapsed_ms() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
+
+bool render_job::past_deadline() const {
+    return deadline_ms > 0 && elapsed_ms() >= deadline_ms;
+}
+
+double render_job::remaining_ms() const {
+    if (deadline_ms <= 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return deadline_ms - elapsed_ms();
+}
+
+void render_job::report(const render_progress& progress) {
+    if (!on_progress) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(report_lock);
+    on_progress(progress);
+}
@@ -0,0 +1,68 @@
+#ifndef RENDER_JOB_H
+#define RENDER_JOB_H
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <functional>
+
+// Stage of a job render
+enum class render_phase {
+    preview,    // One sample per pixel over the whole frame. Always completes unless cancelled.
+    uniform,    // Full-frame passes towards the AA-Factor
+    refine      // Remaining time or budget spent on the noisiest tiles
+};
+
+// Why a job render stopped
+enum class render_status {
+    completed,  // Reached the AA-Factor everywhere
+    deadline,
+    budget,
+    cancelled
+};
+
+const char* phase_name(render_phase phase);
+const char* status_name(render_status status);
+
+// Snapshot handed to the progress callback
+struct render_progress {
+    render_phase    phase           = render_phase::preview;
+    long long       samples_done    = 0;    // Camera samples traced so far
+    long long       samples_target  = 0;    // Camera samples of a complete render
+    int             tiles_done      = 0;    // Tiles finished in the current pass
+    int             tiles_total     = 0;
+    double          elapsed_ms      = 0;
+};
+
+/*
+    Limits and progress reporting of one render. Limits are read when the render starts;
+    cancel() may be called from any thread at any time and takes effect at the next tile boundary.
+*/
+
+class render_job {
+    public:
+        double      deadline_ms     = 0;    // Wall-clock limit measured from start(), 0 for none
+        long long   sample_budget   = 0;    // Limit on camera samples (primary rays) traced, 0 for none
+
+        // Called after every finished tile and pass. Calls are serialized but may come from any render worker.
+        std::function<void(const render_progress&)> on_progress;
+
+        // Resets the clock and the cancellation flag
+        void    start();
+        void    cancel();
+        bool    cancelled() const;
+
+        double  elapsed_ms() const;
+        bool    past_deadline() const;
+        // Wall-clock time left before the deadline, or infinity without one
+        double  remaining_ms() const;
+
+        void    report(const render_progress& progress);
+
+    private:
+        std::atomic<bool>                       cancel_requested{false};
+        std::chrono::steady_clock::time_point   started = std::chrono::steady_clock::now();
+        std::mutex                              report_lock;
+};
+
+#endif
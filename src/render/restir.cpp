@@ -0,0 +1,189 @@
+#include "restir.h"
+#include <limits>
+#include <cmath>
+
+void restir_integrator::reservoir::update(const light_candidate& c, Real w, Real u) {
+    w_sum += w;
+    if (w > 0 && u * w_sum < w) {
+        sample = c;
+    }
+}
+
+restir_integrator::restir_integrator(objs& scene, const light_list& lights, int width, int height, const restir_settings& settings)
+    : scene(scene), lights(lights), width(width), height(height), settings(settings) {
+    const size_t pixels = static_cast<size_t>(width) * height;
+    surfaces.resize(pixels);
+    previous.resize(pixels);
+    current.resize(pixels);
+    reused.resize(pixels);
+    history.resize(pixels);
+}
+
+Real restir_integrator::target(const surface& s, const light_candidate& c) const {
+    return luminance(contribution(s, c));
+}
+
+color restir_integrator::contribution(const surface& s, const light_candidate& c) const {
+    if (c.emitter == nullptr || s.mat == nullptr) {
+        return color(0, 0, 0);
+    }
+    vec3 to_light = c.point - s.point;
+    Real dist2 = to_light * to_light;
+    if (dist2 <= 0) {
+        return color(0, 0, 0);
+    }
+    Real dist = std::sqrt(dist2);
+    vec3 wi = to_light / dist;
+
+    // BSDF times cosine at the surface, emission, and the geometry term of the area measure
+    Real geometry = std::fabs(c.normal * wi) / dist2;
+    color f = s.mat->eval(wi, s.normal, s.u, s.v, s.point);
+    return hadamard(f, c.emitter->get_material()->emit(c.point)) * geometry;
+}
+
+bool restir_integrator::visible(const surface& s, const light_candidate& c) const {
+    vec3 to_light = c.point - s.point;
+    Real dist = to_light.magnitude();
+    hit_history blocker;
+    return !scene.ray_hit(ray(s.point, to_light / dist), 1e-4, dist * (1 - 1e-4), blocker);
+}
+
+bool restir_integrator::similar(const surface& a, const surface& b) {
+    // Normals within about 25 degrees and depths within 10%
+    return b.mat != nullptr && a.normal * b.normal > 0.9 && std::fabs(a.t - b.t) <= 0.1 * a.t;
+}
+
+void restir_integrator::merge(reservoir& into, const reservoir& r, const surface& s, Real max_m) const {
+    Real m = std::fmin(r.m, max_m);
+    if (m <= 0) {
+        return;
+    }
+    // The sample's weight is re-evaluated at s: r stands for m candidates distributed roughly like target / W
+    into.update(r.sample, target(s, r.sample) * r.weight * m, utils::random_double(0, 1));
+    into.m += m;
+}
+
+void restir_integrator::finalize(reservoir& r, const surface& s) const {
+    Real p = target(s, r.sample);
+    r.weight = p > 0 && r.m > 0 ? r.w_sum / (r.m * p) : 0;
+}
+
+void restir_integrator::finalize(reservoir& r, const surface& s, const surface* const* sources, const Real* counts, int n) const {
+    // Only the inputs that could have produced the kept sample count towards the normalization, which removes
+    // the darkening of 1/M where the neighbours see the light from behind
+    Real z = 0;
+    for (int i = 0; i < n; i++) {
+        if (target(*sources[i], r.sample) > 0) {
+            z += counts[i];
+        }
+    }
+    Real p = target(s, r.sample);
+    r.weight = p > 0 && z > 0 ? r.w_sum / (z * p) : 0;
+}
+
+bool restir_integrator::sample(int pixel, const ray& primary, aov_sample* aov) {
+    surface& s = surfaces[pixel];
+    s = surface();
+    current[pixel] = reservoir();
+    reused[pixel] = reservoir();
+
+    hit_history hist;
+    if (!scene.ray_hit(primary, 1e-4, std::numeric_limits<Real>::infinity(), hist)) {
+        return false;
+    }
+    if (aov) {
+        *aov = {hist.material_->get_albedo(hist.u, hist.v, hist.intersection), hist.normal, hist.t, true};
+    }
+    if (hist.material_->is_emissive() || !hist.material_->has_density()) {
+        return false;
+    }
+
+    s.mat = hist.material_.get();
+    s.point = hist.intersection;
+    s.normal = hist.normal;
+    s.incoming = primary.get_direction();
+    s.u = hist.u;
+    s.v = hist.v;
+    s.t = hist.t;
+    s.front = hist.is_front;
+
+    // Initial candidates, resampled against the unshadowed contribution
+    reservoir initial;
+    for (int i = 0; i < settings.candidates; i++) {
+        Real u0 = utils::random_double(0, 1);
+        Real u1 = utils::random_double(0, 1);
+        Real u2 = utils::random_double(0, 1);
+        light_candidate c = lights.sample_point(s.point, s.normal, u0, u1, u2);
+        Real w = c.pdf_area > 0 ? target(s, c) / c.pdf_area : 0;
+        initial.update(c, w, utils::random_double(0, 1));
+        initial.m += 1;
+    }
+    finalize(initial, s);
+
+    // Visibility reuse: an occluded sample is not passed on to neighbours or later passes
+    if (initial.weight > 0 && !visible(s, initial.sample)) {
+        initial.weight = 0;
+    }
+
+    if (!settings.temporal) {
+        current[pixel] = initial;
+        return true;
+    }
+
+    reservoir combined;
+    const surface* sources[2] = {&s, &previous[pixel]};
+    Real counts[2] = {initial.m, 0};
+    merge(combined, initial, s, initial.m);
+    if (similar(s, previous[pixel])) {
+        counts[1] = std::fmin(history[pixel].m, Real(settings.history_limit) * settings.candidates);
+        merge(combined, history[pixel], s, counts[1]);
+    }
+    finalize(combined, s, sources, counts, 2);
+    current[pixel] = combined;
+    return true;
+}
+
+color restir_integrator::shade(int pixel, ray& scattered, color& attenuation) {
+    const surface& s = surfaces[pixel];
+    reservoir r = current[pixel];
+
+    if (settings.spatial) {
+        std::vector<const surface*> sources = {&s};
+        std::vector<Real> counts = {r.m};
+        reservoir combined;
+        merge(combined, r, s, r.m);
+        int x = pixel % width;
+        int y = pixel / width;
+        for (int k = 0; k < settings.neighbours; k++) {
+            int nx = x + static_cast<int>(std::lround(utils::random_double(-1, 1) * settings.radius));
+            int ny = y + static_cast<int>(std::lround(utils::random_double(-1, 1) * settings.radius));
+            if (nx < 0 || ny < 0 || nx >= width || ny >= height || (nx == x && ny == y)) {
+                continue;
+            }
+            int other = ny * width + nx;
+            if (similar(s, surfaces[other])) {
+                merge(combined, current[other], s, current[other].m);
+                sources.push_back(&surfaces[other]);
+                counts.push_back(current[other].m);
+            }
+        }
+        finalize(combined, s, sources.data(), counts.data(), static_cast<int>(sources.size()));
+        r = combined;
+    }
+    reused[pixel] = r;
+
+    // Continuation ray for the caller's indirect estimate
+    auto bs = s.mat->sample(ray(s.point - s.t * s.incoming, s.incoming), s.normal, s.point, s.front, s.u, s.v);
+    attenuation = bs.weight;
+    scattered = bs.scattered;
+
+    if (r.weight <= 0 || !visible(s, r.sample)) {
+        return color(0, 0, 0);
+    }
+    return contribution(s, r.sample) * r.weight;
+}
+
+void restir_integrator::end_pass() {
+    history.swap(reused);
+    previous.swap(surfaces);
+}
@@ -0,0 +1,104 @@
+#ifndef RESTIR_H
+#define RESTIR_H
+
+#include <vector>
+#include "../ray.h"
+#include "../color.h"
+#include "../objects/objs.h"
+#include "../sampling/lights.h"
+#include "film.h"
+
+/*
+    Reservoir-based spatiotemporal resampling of direct lighting (ReSTIR DI, Bitterli et al. 2020), for previews
+    at one sample per pixel. Every pixel keeps a reservoir holding one light sample chosen from many:
+
+        sample      trace the primary ray, draw candidates from the light BVH and keep one by weighted reservoir
+                    sampling against the unshadowed contribution, then merge the pixel's reservoir of the last pass
+        reuse       merge the reservoirs of a few random neighbours with a similar surface, and shade the kept
+                    sample with one shadow ray
+
+    Both stages run pixel by pixel and only read what the previous stage wrote, so the caller runs each of them as a
+    parallel loop over tiles. Samples are kept per unit area of the emitter so they can move between pixels without
+    a Jacobian. Merged reservoirs are normalized by the candidates of the inputs that could have produced the kept
+    sample, ignoring visibility, which darkens contact shadows slightly. The camera must not move between passes.
+*/
+
+struct restir_settings {
+    int     candidates      = 8;        // Light samples drawn per pixel and pass
+    bool    temporal        = true;     // Merge the pixel's reservoir of the previous pass
+    bool    spatial         = true;     // Merge neighbouring reservoirs
+    int     neighbours      = 4;
+    int     radius          = 16;       // Pixels
+    int     history_limit   = 5;        // Cap on the samples a reservoir remembers, in passes' worth of candidates
+};
+
+class restir_integrator {
+    public:
+        restir_integrator(objs& scene, const light_list& lights, int width, int height, const restir_settings& settings = restir_settings());
+
+        // Stage 1 for one pixel. Returns false when the primary ray misses or hits a surface without a density
+        // (mirrors, glass, emitters): those pixels are not resampled and take a regular path sample instead.
+        // aov, if given, receives the first hit.
+        bool    sample(int pixel, const ray& primary, aov_sample* aov = nullptr);
+
+        // Stage 2 for one pixel that sample accepted: the direct light it sends towards the camera.
+        // scattered receives a continuation ray for indirect light, and attenuation its weight.
+        color   shade(int pixel, ray& scattered, color& attenuation);
+
+        // Ends a pass: the reused reservoirs become the history of the next one
+        void    end_pass();
+
+    private:
+        // Surface seen through a pixel, for the target function and the neighbour similarity test
+        struct surface {
+            const material* mat     = nullptr;      // nullptr: nothing to resample
+            vec3            point;
+            vec3            normal;
+            vec3            incoming;               // Direction of the primary ray
+            Real            u       = 0;
+            Real            v       = 0;
+            Real            t       = 0;
+            bool            front   = true;
+        };
+
+        struct reservoir {
+            light_candidate sample;
+            Real            w_sum   = 0;        // Sum of the resampling weights seen
+            Real            m       = 0;        // Number of candidates seen
+            Real            weight  = 0;        // Contribution weight W of the kept sample
+
+            // Weighted reservoir sampling step: keeps c with probability w / w_sum
+            void update(const light_candidate& c, Real w, Real u);
+        };
+
+        objs&               scene;
+        const light_list&   lights;
+        int                 width;
+        int                 height;
+        restir_settings     settings;
+
+        std::vector<surface>    surfaces;
+        std::vector<surface>    previous;       // surfaces of the previous pass
+        std::vector<reservoir>  current;        // After stage 1
+        std::vector<reservoir>  reused;         // After stage 2
+        std::vector<reservoir>  history;        // reused of the previous pass
+
+        // Unshadowed luminance of the light sample at the surface, per unit area of the emitter
+        Real    target(const surface& s, const light_candidate& c) const;
+        color   contribution(const surface& s, const light_candidate& c) const;
+        bool    visible(const surface& s, const light_candidate& c) const;
+
+        // Whether reservoirs of surface b may be reused at surface a
+        static bool similar(const surface& a, const surface& b);
+
+        // Merges r (from another pixel or pass, with its candidate count capped at max_m) into into at surface s
+        void    merge(reservoir& into, const reservoir& r, const surface& s, Real max_m) const;
+
+        // Sets W from w_sum and m for the sample kept at s
+        void    finalize(reservoir& r, const surface& s) const;
+
+        // Same for a reservoir merged from n inputs, the reservoir of sources[i] standing for counts[i] candidates
+        void    finalize(reservoir& r, const surface& s, const surface* const* sources, const Real* counts, int n) const;
+};
+
+#endif
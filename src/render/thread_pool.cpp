@@ -0,0 +1,152 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+thread_pool::thread_pool(int threads, bool pin) {
+    const auto& topo = topology::detect();
+    if (threads <= 0) {
+        threads = topo.usable_threads();
+    }
+
+    // Fill the nodes one CPU per worker
+    std::vector<int> slots;     // Node of every usable CPU
+    for (int n = 0; n < static_cast<int>(topo.nodes.size()); n++) {
+        slots.insert(slots.end(), topo.nodes[n].size(), n);
+    }
+    is_pinned = pin && threads <= static_cast<int>(slots.size());
+    for (int i = 0; i < threads; i++) {
+        worker_node.push_back(slots[i % slots.size()]);
+    }
+    nodes_used = 1 + *std::max_element(worker_node.begin(), worker_node.end());
+
+    for (int i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<task_queue>());
+    }
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(&thread_pool::worker_loop, this, i);
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> guard(job_lock);
+        stopping = true;
+    }
+    job_ready.notify_all();
+
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+int thread_pool::size() const {
+    return static_cast<int>(workers.size());
+}
+
+int thread_pool::node_of(int worker) const {
+    return worker_node[worker];
+}
+
+int thread_pool::node_count() const {
+    return nodes_used;
+}
+
+bool thread_pool::pinned() const {
+    return is_pinned;
+}
+
+void thread_pool::parallel_for(int count, const std::function<void(int, int)>& task) {
+    if (count <= 0) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> guard(job_lock);
+
+    // Deal indices round-robin so every worker starts at the front of the submission order
+    int n = size();
+    for (int w = 0; w < n; w++) {
+        std::lock_guard<std::mutex> queue_guard(queues[w]->lock);
+        queues[w]->items.clear();
+        for (int i = w; i < count; i += n) {
+            queues[w]->items.push_back(i);
+        }
+    }
+
+    job = &task;
+    remaining.store(count);
+    generation++;
+    job_ready.notify_all();
+
+    // Every task finished and no worker is still inside the job, so the next call cannot be picked up with a stale task
+    job_done.wait(guard, [this] { return remaining.load() == 0 && busy == 0; });
+    job = nullptr;
+}
+
+bool thread_pool::next_task(int id, int& index) {
+    // Own deque first, oldest task first
+    {
+        auto& own = *queues[id];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.items.empty()) {
+            index = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+
+    // Steal the newest task of the other workers, on the same node first so the tile's memory stays local
+    int n = size();
+    for (int same_node = 1; same_node >= 0; same_node--) {
+        for (int k = 1; k < n; k++) {
+            int other = (id + k) % n;
+            if ((worker_node[other] == worker_node[id]) != (same_node == 1)) {
+                continue;
+            }
+            auto& victim = *queues[other];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.items.empty()) {
+                index = victim.items.back();
+                victim.items.pop_back();
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void thread_pool::worker_loop(int id) {
+    unsigned long long seen = 0;
+    if (is_pinned) {
+        topology::pin_current_thread(topology::detect().nodes[worker_node[id]]);
+    }
+
+    while (true) {
+        const std::function<void(int, int)>* task;
+        {
+            std::unique_lock<std::mutex> guard(job_lock);
+            job_ready.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            task = job;
+            if (task == nullptr) {
+                // Woke up after the job already completed
+                continue;
+            }
+            busy++;
+        }
+
+        int index;
+        while (next_task(id, index)) {
+            (*task)(index, id);
+            remaining.fetch_sub(1);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(job_lock);
+            busy--;
+        }
+        job_done.notify_all();
+    }
+}
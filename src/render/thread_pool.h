@@ -0,0 +1,69 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "topology.h"
+
+/*
+    Persistent pool of worker threads with one task deque per worker.
+    Work is dealt round-robin in submission order; each worker pops from the front of its own deque
+    and, once empty, steals from the back of the others, on its own NUMA node first.
+    Workers are assigned to nodes CPU by CPU, so a pool smaller than the machine stays on as few nodes as possible,
+    and each is pinned to its node's CPUs rather than to one CPU: the OS still balances threads within the node, so
+    pools of several processes on one machine do not all pile onto its first CPUs.
+*/
+
+class thread_pool {
+    public:
+        // 0 threads picks the CPUs usable under the affinity mask and CPU quota (see topology.h).
+        // Pinning is skipped when there are more threads than usable CPUs.
+        explicit thread_pool(int threads = 0, bool pin = true);
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        int size() const;
+
+        // NUMA node of a worker (an index into cpu_topology::nodes), and the number of nodes the workers span
+        int node_of(int worker) const;
+        int node_count() const;
+        bool pinned() const;
+
+        // Runs task(index, worker_id) for every index in [0, count) and blocks until all are done.
+        // Not reentrant: tasks must not call parallel_for on the same pool.
+        void parallel_for(int count, const std::function<void(int, int)>& task);
+
+    private:
+        struct task_queue {
+            std::mutex      lock;
+            std::deque<int> items;
+        };
+
+        std::vector<std::thread>                    workers;
+        std::vector<int>                            worker_node;
+        int                                         nodes_used  = 1;
+        bool                                        is_pinned   = false;
+        std::vector<std::unique_ptr<task_queue>>    queues;
+
+        std::mutex                                  job_lock;
+        std::condition_variable                     job_ready;
+        std::condition_variable                     job_done;
+        const std::function<void(int, int)>*        job         = nullptr;
+        unsigned long long                          generation  = 0;
+        bool                                        stopping    = false;
+        int                                         busy        = 0;       // Workers currently inside a job
+        std::atomic<int>                            remaining{0};
+
+        void worker_loop(int id);
+        bool next_task(int id, int& index);
+};
+
+#endif
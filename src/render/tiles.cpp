@@ -0,0 +1,110 @@
+#include "tiles.h"
+#include "../config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+    // Interleaves the lower 16 bits of x and y
+    uint32_t morton_code(uint32_t x, uint32_t y) {
+        auto spread = [](uint32_t v) {
+            v &= 0x0000ffff;
+            v = (v | (v << 8)) & 0x00ff00ff;
+            v = (v | (v << 4)) & 0x0f0f0f0f;
+            v = (v | (v << 2)) & 0x33333333;
+            v = (v | (v << 1)) & 0x55555555;
+            return v;
+        };
+        return spread(x) | (spread(y) << 1);
+    }
+}
+
+std::vector<tile> make_tiles(int width, int height, int tile_size, tile_order order) {
+    tile_size = std::max(1, tile_size);
+    int cols = (width + tile_size - 1) / tile_size;
+    int rows = (height + tile_size - 1) / tile_size;
+
+    struct keyed_tile {
+        tile    t;
+        Real    key;
+        Real    key2;
+    };
+    std::vector<keyed_tile> keyed;
+    keyed.reserve(cols * rows);
+
+    Real cx = (cols - 1) / Real(2);
+    Real cy = (rows - 1) / Real(2);
+
+    for (int ty = 0; ty < rows; ty++) {
+        for (int tx = 0; tx < cols; tx++) {
+            tile t = {tx * tile_size, ty * tile_size,
+                      std::min(width, (tx + 1) * tile_size), std::min(height, (ty + 1) * tile_size)};
+
+            Real key = 0, key2 = 0;
+            switch (order) {
+                case tile_order::scanline: {
+                    key = ty * cols + tx;
+                    break;
+                }
+                case tile_order::morton: {
+                    key = morton_code(tx, ty);
+                    break;
+                }
+                case tile_order::spiral: {
+                    // Square rings around the center, walked by angle within each ring
+                    key = std::fmax(std::fabs(tx - cx), std::fabs(ty - cy));
+                    key2 = std::atan2(ty - cy, tx - cx);
+                    break;
+                }
+            }
+            keyed.push_back({t, key, key2});
+        }
+    }
+
+    std::stable_sort(keyed.begin(), keyed.end(), [](const keyed_tile& a, const keyed_tile& b) {
+        return a.key < b.key || (a.key == b.key && a.key2 < b.key2);
+    });
+
+    std::vector<tile> tiles;
+    tiles.reserve(keyed.size());
+    for (const auto& k : keyed) {
+        tiles.push_back(k.t);
+    }
+    return tiles;
+}
+
+tile intersect(const tile& a, const tile& b) {
+    return {std::max(a.x0, b.x0), std::max(a.y0, b.y0), std::min(a.x1, b.x1), std::min(a.y1, b.y1)};
+}
+
+long long total_pixels(const std::vector<tile>& tiles) {
+    long long pixels = 0;
+    for (const auto& t : tiles) {
+        pixels += t.pixel_count();
+    }
+    return pixels;
+}
+
+std::vector<tile> clip_tiles(const std::vector<tile>& tiles, const tile& rect) {
+    std::vector<tile> clipped;
+    for (const auto& t : tiles) {
+        auto part = intersect(t, rect);
+        if (!part.empty()) {
+            clipped.push_back(part);
+        }
+    }
+    return clipped;
+}
+
+std::vector<tile> touched_tiles(const std::vector<tile>& tiles, const std::vector<tile>& regions) {
+    std::vector<tile> touched;
+    for (const auto& t : tiles) {
+        for (const auto& r : regions) {
+            if (!intersect(t, r).empty()) {
+                touched.push_back(t);
+                break;
+            }
+        }
+    }
+    return touched;
+}
@@ -0,0 +1,46 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <vector>
+
+// Screen-space tile covering pixels [x0, x1) x [y0, y1)
+struct tile {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+
+    int pixel_count() const { return (x1 - x0) * (y1 - y0); }
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+};
+
+// Overlap of two rectangles (empty if they do not overlap)
+tile intersect(const tile& a, const tile& b);
+
+// Order in which tiles are handed to the scheduler
+enum class tile_order {
+    scanline,   // Row by row
+    morton,     // Z-order curve, keeps consecutive tiles spatially close
+    spiral      // From the image center outwards, so the subject shows up first
+};
+
+// Timing record of one rendered tile
+struct tile_stats {
+    tile    bounds;
+    double  ms      = 0;
+    int     worker  = -1;
+};
+
+// Splits a width x height image into square tiles of tile_size pixels (edge tiles are cropped)
+std::vector<tile> make_tiles(int width, int height, int tile_size, tile_order order);
+
+// Pixels covered by the tiles
+long long total_pixels(const std::vector<tile>& tiles);
+
+// The parts of the tiles inside rect, in the same order; tiles outside it are dropped
+std::vector<tile> clip_tiles(const std::vector<tile>& tiles, const tile& rect);
+
+// The tiles that overlap any of the regions, uncut and in the same order
+std::vector<tile> touched_tiles(const std::vector<tile>& tiles, const std::vector<tile>& regions);
+
+#endif
@@ -0,0 +1,100 @@
+#include "tonemap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+const char* tone_operator_name(tone_operator op) {
+    switch (op) {
+        case tone_operator::clamp:    return "clamp";
+        case tone_operator::reinhard: return "reinhard";
+        case tone_operator::aces:     return "aces";
+    }
+    return "unknown";
+}
+
+namespace {
+    // Linear [0, 1] to 8-bit sRGB, sampled finely enough that neighbouring entries differ by at most one code
+    constexpr int lut_size = 4096;
+
+    struct srgb_table {
+        unsigned char codes[lut_size];
+
+        srgb_table() {
+            for (int i = 0; i < lut_size; i++) {
+                double x = static_cast<double>(i) / (lut_size - 1);
+                double s = x <= 0.0031308 ? 12.92 * x : 1.055 * std::pow(x, 1 / 2.4) - 0.055;
+                codes[i] = static_cast<unsigned char>(std::min(255, static_cast<int>(s * 256)));
+            }
+        }
+    };
+
+    const srgb_table& srgb_lut() {
+        static const srgb_table table;
+        return table;
+    }
+
+    // Clamps x to [0, hi], sending NaN to 0. Works on the bit pattern, where non-negative floats order like integers and
+    // NaN sits above +inf: float compares and selects would keep the curve loop from vectorizing (see denoise.cpp).
+    inline float clamp_bits(float x, float hi) {
+        int32_t bits, top;
+        std::memcpy(&bits, &x, sizeof(bits));
+        std::memcpy(&top, &hi, sizeof(top));
+        bits &= -static_cast<int32_t>(bits <= 0x7f800000);      // +NaN
+        bits = std::max(bits, 0);                               // Negative values, -0 and -NaN
+        bits = std::min(bits, top);                             // +inf included
+        std::memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+
+    // Radiance this far above white maps to white under every curve, and keeps ACES' products finite
+    constexpr float max_radiance = 1e6f;
+
+    template <tone_operator Op>
+    inline float curve(float x) {
+        if constexpr (Op == tone_operator::clamp) {
+            return clamp_bits(x, 1.0f);
+        } else if constexpr (Op == tone_operator::reinhard) {
+            x = clamp_bits(x, max_radiance);
+            return x / (1.0f + x);
+        } else {
+            x = clamp_bits(x, max_radiance);
+            return clamp_bits((x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f), 1.0f);
+        }
+    }
+
+    template <tone_operator Op>
+    void apply_kernel(const float* rgba, unsigned char* rgb, int count, float exposure) {
+        constexpr int block = 64;
+        const auto& lut = srgb_lut();
+        int index[block * 4];
+
+        for (int start = 0; start < count; start += block) {
+            const int n = std::min(block, count - start);
+            const float* src = rgba + static_cast<size_t>(start) * 4;
+
+            // Curve and table index over the block, branch-free and over all four channels, so the loads are
+            // contiguous (alpha's index goes unused). The curve ends in [0, 1], so every index is in the table.
+            for (int c = 0; c < n * 4; c++) {
+                index[c] = static_cast<int>(curve<Op>(src[c] * exposure) * (lut_size - 1) + 0.5f);
+            }
+
+            unsigned char* dst = rgb + static_cast<size_t>(start) * 3;
+            for (int p = 0; p < n; p++) {
+                dst[p * 3 + 0] = lut.codes[index[p * 4 + 0]];
+                dst[p * 3 + 1] = lut.codes[index[p * 4 + 1]];
+                dst[p * 3 + 2] = lut.codes[index[p * 4 + 2]];
+            }
+        }
+    }
+}
+
+namespace tonemap {
+    void apply(const float* rgba, unsigned char* rgb, int count, tone_operator op, float exposure) {
+        switch (op) {
+            case tone_operator::clamp:    apply_kernel<tone_operator::clamp>(rgba, rgb, count, exposure); break;
+            case tone_operator::reinhard: apply_kernel<tone_operator::reinhard>(rgba, rgb, count, exposure); break;
+            case tone_operator::aces:     apply_kernel<tone_operator::aces>(rgba, rgb, count, exposure); break;
+        }
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef TONEMAP_H
+#define TONEMAP_H
+
+// Curve that maps unbounded linear radiance into [0, 1] for display
+enum class tone_operator {
+    clamp,      // Cuts everything above 1 (the original look)
+    reinhard,   // x / (1 + x)
+    aces        // Narkowicz's fit of the ACES filmic curve
+};
+
+const char* tone_operator_name(tone_operator op);
+
+namespace tonemap {
+    // Develops count RGBA float pixels of linear radiance into 8-bit sRGB RGB: scales by exposure, applies the
+    // operator and encodes through a lookup table. Alpha is ignored; NaN and negative values develop to black, +inf to
+    // white. Runs over blocks of pixels in straight-line loops: the curve vectorizes, the table lookups stay scalar.
+    void apply(const float* rgba, unsigned char* rgb, int count, tone_operator op, float exposure);
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "topology.h"
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Parses a Linux CPU list such as "0-3,8-11"
+    std::vector<int> parse_cpu_list(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream in(list);
+        std::string range;
+        while (std::getline(in, range, ',')) {
+            int first, last;
+            char dash;
+            std::stringstream r(range);
+            if (!(r >> first)) {
+                continue;
+            }
+            last = (r >> dash >> last) ? last : first;
+            for (int c = first; c <= last; c++) {
+                cpus.push_back(c);
+            }
+        }
+        return cpus;
+    }
+
+    std::string read_line(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+
+#ifndef _WIN32
+    // CPU quota of the cgroup in whole CPUs, 0 when unlimited or unknown
+    double cgroup_quota() {
+        // cgroup v2: "<quota> <period>" or "max <period>", in the process' own group or at the root
+        std::string group;
+        std::ifstream self("/proc/self/cgroup");
+        for (std::string line; std::getline(self, line);) {
+            if (line.compare(0, 3, "0::") == 0) {
+                group = line.substr(3);
+            }
+        }
+        for (const auto& path : {"/sys/fs/cgroup" + group + "/cpu.max", std::string("/sys/fs/cgroup/cpu.max")}) {
+            std::stringstream in(read_line(path));
+            std::string quota;
+            double period;
+            if (in >> quota >> period) {
+                return quota == "max" || period <= 0 ? 0 : std::stod(quota) / period;
+            }
+        }
+
+        // cgroup v1: a quota of -1 means unlimited
+        for (const std::string dir : {"/sys/fs/cgroup/cpu/", "/sys/fs/cgroup/cpu,cpuacct/"}) {
+            std::stringstream quota_in(read_line(dir + "cpu.cfs_quota_us"));
+            std::stringstream period_in(read_line(dir + "cpu.cfs_period_us"));
+            double quota, period;
+            if (quota_in >> quota && period_in >> period) {
+                return quota <= 0 || period <= 0 ? 0 : quota / period;
+            }
+        }
+        return 0;
+    }
+#endif
+
+    cpu_topology detect_topology() {
+        cpu_topology topo;
+        std::vector<int> allowed;
+
+#ifdef _WIN32
+        // Processor group 0 only (up to 64 CPUs)
+        topo.online_cpus = static_cast<int>(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS));
+
+        DWORD_PTR process_mask = 0, system_mask = 0;
+        if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+            for (int c = 0; c < static_cast<int>(sizeof(DWORD_PTR) * 8); c++) {
+                if (process_mask & (static_cast<DWORD_PTR>(1) << c)) {
+                    allowed.push_back(c);
+                }
+            }
+        }
+
+        JOBOBJECT_CPU_RATE_CONTROL_INFORMATION rate = {};
+        if (QueryInformationJobObject(nullptr, JobObjectCpuRateControlInformation, &rate, sizeof(rate), nullptr)
+            && (rate.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_ENABLE) && (rate.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP)) {
+            // CpuRate is in hundredths of a percent of the whole machine
+            topo.quota_cpus = rate.CpuRate / 10000.0 * topo.online_cpus;
+        }
+
+        ULONG highest = 0;
+        if (GetNumaHighestNodeNumber(&highest)) {
+            for (ULONG n = 0; n <= highest; n++) {
+                ULONGLONG mask = 0;
+                std::vector<int> node;
+                if (GetNumaNodeProcessorMask(static_cast<UCHAR>(n), &mask)) {
+                    for (int c : allowed) {
+                        if (c < 64 && (mask & (1ull << c))) {
+                            node.push_back(c);
+                        }
+                    }
+                }
+                if (!node.empty()) {
+                    topo.nodes.push_back(node);
+                }
+            }
+        }
+#else
+        topo.online_cpus = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int c = 0; c < CPU_SETSIZE; c++) {
+                if (CPU_ISSET(c, &set)) {
+                    allowed.push_back(c);
+                }
+            }
+        }
+
+        topo.quota_cpus = cgroup_quota();
+
+        for (int n : parse_cpu_list(read_line("/sys/devices/system/node/online"))) {
+            std::vector<int> node;
+            for (int c : parse_cpu_list(read_line("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist"))) {
+                if (std::find(allowed.begin(), allowed.end(), c) != allowed.end()) {
+                    node.push_back(c);
+                }
+            }
+            if (!node.empty()) {
+                topo.nodes.push_back(node);
+            }
+        }
+#endif
+
+        // No NUMA information: one node of every allowed CPU
+        if (topo.nodes.empty()) {
+            if (allowed.empty()) {
+                for (int c = 0; c < static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); c++) {
+                    allowed.push_back(c);
+                }
+            }
+            topo.nodes.push_back(allowed);
+        }
+        topo.online_cpus = std::max(topo.online_cpus, topo.affinity_cpus());
+        return topo;
+    }
+}
+
+int cpu_topology::affinity_cpus() const {
+    int count = 0;
+    for (const auto& node : nodes) {
+        count += static_cast<int>(node.size());
+    }
+    return count;
+}
+
+int cpu_topology::usable_threads() const {
+    int threads = affinity_cpus();
+    if (quota_cpus > 0) {
+        threads = std::min(threads, static_cast<int>(std::ceil(quota_cpus)));
+    }
+    return std::max(1, threads);
+}
+
+std::string cpu_topology::describe() const {
+    std::ostringstream out;
+    out << affinity_cpus() << " of " << online_cpus << " CPUs";
+    if (quota_cpus > 0) {
+        out << " (quota " << quota_cpus << ")";
+    }
+    out << ", " << nodes.size() << " NUMA node" << (nodes.size() == 1 ? "" : "s");
+    return out.str();
+}
+
+namespace topology {
+    const cpu_topology& detect() {
+        static const cpu_topology topo = detect_topology();
+        return topo;
+    }
+
+    bool pin_current_thread(const std::vector<int>& cpus) {
+#ifdef _WIN32
+        DWORD_PTR mask = 0;
+        for (int cpu : cpus) {
+            if (cpu < 64) {
+                mask |= static_cast<DWORD_PTR>(1) << cpu;
+            }
+        }
+        return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        return CPU_COUNT(&set) != 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <vector>
+#include <string>
+
+/*
+    CPUs the process may actually use, and how they group into NUMA nodes.
+    hardware_concurrency() reports every CPU of the host, which oversubscribes inside a container with a
+    CPU quota; the quota, the affinity mask and the node layout are read from the OS instead
+    (cgroup v1/v2 and sysfs on Linux, job objects and the NUMA API on Windows).
+*/
+
+struct cpu_topology {
+    std::vector<std::vector<int>>   nodes;              // Usable CPU ids per NUMA node (nodes without usable CPUs are dropped)
+    int                             online_cpus = 1;    // CPUs of the host
+    double                          quota_cpus  = 0;    // CPU quota in whole CPUs (0 when unlimited)
+
+    // CPUs in the affinity mask, over all nodes
+    int     affinity_cpus() const;
+
+    // Threads to run: the affinity mask, capped by the quota (rounded up)
+    int     usable_threads() const;
+
+    // e.g. "6 of 32 CPUs (quota 6), 2 NUMA nodes"
+    std::string describe() const;
+};
+
+namespace topology {
+    // Detected once; falls back to a single node of hardware_concurrency() CPUs
+    const cpu_topology& detect();
+
+    // Binds the calling thread to a set of CPUs (e.g. one node's). Returns false where unsupported.
+    bool pin_current_thread(const std::vector<int>& cpus);
+}
+
+#endif
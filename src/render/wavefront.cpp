@@ -0,0 +1,207 @@
+#include "wavefront.h"
+#include <limits>
+#include <algorithm>
+#include "../material/diffuse.h"
+#include "../material/metal.h"
+#include "../material/dielectric.h"
+#include "../material/bulb.h"
+
+void path_queue::resize(int n) {
+    ox.resize(n); oy.resize(n); oz.resize(n);
+    dx.resize(n); dy.resize(n); dz.resize(n);
+    tr.assign(n, 1); tg.assign(n, 1); tb.assign(n, 1);
+    lr.assign(n, 0); lg.assign(n, 0); lb.assign(n, 0);
+    bounces.assign(n, 0);
+    pdf.assign(n, 0);
+    nx.resize(n); ny.resize(n); nz.resize(n);
+    specular_run.assign(n, -1);
+}
+
+wavefront_integrator::wavefront_integrator(objs& scene, const color& background, int max_depth, int rr_start_depth, bool sort_by_material,
+                                           const light_list* lights, const photon_map* caustics)
+    : scene(scene), background(background), max_depth(max_depth), rr_start_depth(rr_start_depth), sort_by_material(sort_by_material),
+      lights(lights), caustics(caustics && !caustics->empty() ? caustics : nullptr) {}
+
+void wavefront_integrator::trace(const ray_batch& primary, std::vector<color>& radiance, std::vector<aov_sample>* aovs) {
+    // Generate: copy the primary rays into the path queue
+    const int n = primary.size();
+    paths.resize(n);
+    active.resize(n);
+    for (int i = 0; i < n; i++) {
+        paths.ox[i] = primary.ox[i]; paths.oy[i] = primary.oy[i]; paths.oz[i] = primary.oz[i];
+        paths.dx[i] = primary.dx[i]; paths.dy[i] = primary.dy[i]; paths.dz[i] = primary.dz[i];
+        active[i] = i;
+    }
+
+    for (int bounce = 0; bounce < max_depth && !active.empty(); bounce++) {
+        extend();
+
+        // The first extend still has every path in order, one per primary ray
+        if (aovs && bounce == 0) {
+            aovs->assign(n, aov_sample());
+            for (int k = 0; k < n; k++) {
+                auto& sample = (*aovs)[k];
+                if (hit_found[k]) {
+                    const auto& hist = hits[k];
+                    sample = {hist.material_->get_albedo(hist.u, hist.v, hist.intersection), hist.normal, hist.t, true};
+                } else {
+                    sample.albedo = background;
+                }
+            }
+        }
+        if (sort_by_material) {
+            shade_sorted();
+        } else {
+            shade();
+        }
+    }
+
+    radiance.resize(n);
+    for (int i = 0; i < n; i++) {
+        radiance[i] = color(paths.lr[i], paths.lg[i], paths.lb[i]);
+    }
+}
+
+void wavefront_integrator::extend() {
+    const int count = static_cast<int>(active.size());
+    hits.resize(count);
+    hit_found.resize(count);
+
+    for (int k = 0; k < count; k++) {
+        int p = active[k];
+        ray r(vec3(paths.ox[p], paths.oy[p], paths.oz[p]), vec3(paths.dx[p], paths.dy[p], paths.dz[p]));
+        hit_found[k] = scene.ray_hit(r, 1e-4, std::numeric_limits<Real>::infinity(), hits[k]);
+    }
+}
+
+bool wavefront_integrator::terminate_at(int k) {
+    int p = active[k];
+    vec3 throughput(paths.tr[p], paths.tg[p], paths.tb[p]);
+
+    if (!hit_found[k]) {
+        auto contribution = hadamard(throughput, background);
+        paths.lr[p] += contribution.x(); paths.lg[p] += contribution.y(); paths.lb[p] += contribution.z();
+        return true;
+    }
+
+    const auto& hist = hits[k];
+    if (hist.material_->is_emissive()) {
+        // Emission that light sampling could also have found is MIS weighted; the photon map holds what comes
+        // through a specular chain after a diffuse bounce
+        if (caustics && paths.specular_run[p] > 0) {
+            return true;
+        }
+        Real weight = 1;
+        if (lights && paths.pdf[p] > 0) {
+            weight = lights->emission_weight(vec3(paths.ox[p], paths.oy[p], paths.oz[p]), vec3(paths.nx[p], paths.ny[p], paths.nz[p]),
+                                             paths.pdf[p], hist);
+        }
+        auto emission = hadamard(throughput, hist.material_->emit(hist.intersection)) * weight;
+        paths.lr[p] += emission.x(); paths.lg[p] += emission.y(); paths.lb[p] += emission.z();
+        return true;
+    }
+    return false;
+}
+
+void wavefront_integrator::connect_lights(int k) {
+    if (!lights && !caustics) {
+        return;
+    }
+    int p = active[k];
+    color direct = lights ? lights->sample_direct(scene, hits[k]) : color(0, 0, 0);
+    if (caustics) {
+        direct += caustics->estimate(hits[k]);
+    }
+    direct = hadamard(vec3(paths.tr[p], paths.tg[p], paths.tb[p]), direct);
+    paths.lr[p] += direct.x(); paths.lg[p] += direct.y(); paths.lb[p] += direct.z();
+}
+
+void wavefront_integrator::continue_path(int p, const vec3& attenuation, const ray& secondary, Real pdf, bool specular, const vec3& normal) {
+    vec3 throughput = hadamard(vec3(paths.tr[p], paths.tg[p], paths.tb[p]), attenuation);
+
+    // Connect: Russian roulette, then requeue the survivor with its new ray
+    int bounces = ++paths.bounces[p];
+    if (bounces >= rr_start_depth) {
+        Real survive = std::fmin(max_component(throughput), Real(0.95));
+        if (utils::random_double(0, 1) >= survive) {
+            return;
+        }
+        throughput /= survive;
+    }
+
+    auto o = secondary.get_origin();
+    auto d = secondary.get_direction();
+    paths.ox[p] = o.x(); paths.oy[p] = o.y(); paths.oz[p] = o.z();
+    paths.dx[p] = d.x(); paths.dy[p] = d.y(); paths.dz[p] = d.z();
+    paths.tr[p] = throughput.x(); paths.tg[p] = throughput.y(); paths.tb[p] = throughput.z();
+    paths.pdf[p] = pdf;
+    paths.nx[p] = normal.x(); paths.ny[p] = normal.y(); paths.nz[p] = normal.z();
+    paths.specular_run[p] = !specular ? 0 : (paths.specular_run[p] >= 0 ? paths.specular_run[p] + 1 : -1);
+    next_active.push_back(p);
+}
+
+void wavefront_integrator::shade() {
+    // Unsorted shading: one virtual sample call per hit, in queue order
+    const int count = static_cast<int>(active.size());
+    next_active.clear();
+
+    for (int k = 0; k < count; k++) {
+        if (terminate_at(k)) {
+            continue;
+        }
+
+        int p = active[k];
+        const auto& hist = hits[k];
+        connect_lights(k);
+        ray incoming(vec3(paths.ox[p], paths.oy[p], paths.oz[p]), vec3(paths.dx[p], paths.dy[p], paths.dz[p]));
+        auto bs = hist.material_->sample(incoming, hist.normal, hist.intersection, hist.is_front, hist.u, hist.v);
+        continue_path(p, bs.weight, bs.scattered, bs.pdf, bs.specular, hist.normal);
+    }
+
+    active.swap(next_active);
+}
+
+template <class Material>
+void wavefront_integrator::shade_bin(const std::vector<int>& bin) {
+    for (int k : bin) {
+        int p = active[k];
+        const auto& hist = hits[k];
+        ray incoming(vec3(paths.ox[p], paths.oy[p], paths.oz[p]), vec3(paths.dx[p], paths.dy[p], paths.dz[p]));
+
+        // The material classes are final, so these calls are resolved statically
+        const auto* mat = static_cast<const Material*>(hist.material_.get());
+        if (mat->has_density()) {
+            connect_lights(k);
+        }
+        auto bs = mat->sample(incoming, hist.normal, hist.intersection, hist.is_front, hist.u, hist.v);
+        continue_path(p, bs.weight, bs.scattered, bs.pdf, bs.specular, hist.normal);
+    }
+}
+
+void wavefront_integrator::shade_sorted() {
+    const int count = static_cast<int>(active.size());
+    next_active.clear();
+    for (auto& bin : bins) {
+        bin.clear();
+    }
+
+    // Misses and emitters finish right away; every other hit goes into the bin of its material type
+    for (int k = 0; k < count; k++) {
+        if (!terminate_at(k)) {
+            bins[static_cast<int>(hits[k].material_->get_type())].push_back(k);
+        }
+    }
+
+    // Group textured hits by material so each texture is read in one run
+    auto& textured = bins[static_cast<int>(material_type::textured)];
+    std::stable_sort(textured.begin(), textured.end(), [&](int a, int b) {
+        return hits[a].material_.get() < hits[b].material_.get();
+    });
+
+    shade_bin<diffuse>(bins[static_cast<int>(material_type::diffuse)]);
+    shade_bin<diffuse>(textured);
+    shade_bin<metal>(bins[static_cast<int>(material_type::metal)]);
+    shade_bin<dielectric>(bins[static_cast<int>(material_type::dielectric)]);
+
+    active.swap(next_active);
+}
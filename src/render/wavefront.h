@@ -0,0 +1,89 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include <vector>
+#include "../ray.h"
+#include "../color.h"
+#include "../objects/objs.h"
+#include "film.h"
+#include "../sampling/lights.h"
+#include "photons.h"
+
+/*
+    Wavefront path tracer. Instead of following one path to completion, all paths of a tile advance
+    together one stage at a time over SoA queues:
+
+        generate    primary rays come in as a ray_batch (camera::generate_rays)
+        extend      intersect every active ray with the scene
+        shade       evaluate emission and sample the next direction for every hit
+        connect     add finished paths to their radiance, apply Russian roulette and compact the active queue
+
+    Each stage is a tight loop over one kind of work, which keeps traversal and shading code hot in the caches.
+*/
+
+// Per-path state, indexed by path id (the index of the primary ray in the batch)
+struct path_queue {
+    std::vector<Real>   ox, oy, oz;     // Current ray
+    std::vector<Real>   dx, dy, dz;
+    std::vector<Real>   tr, tg, tb;     // Throughput
+    std::vector<Real>   lr, lg, lb;     // Accumulated radiance
+    std::vector<int>    bounces;
+    std::vector<Real>   pdf;            // Density the current ray was sampled with (0: camera ray or delta scattering)
+    std::vector<Real>   nx, ny, nz;     // and the surface normal at its origin
+    std::vector<int>    specular_run;   // Specular bounces since the last one at a surface with a density (-1: none yet)
+
+    void resize(int n);
+};
+
+class wavefront_integrator {
+    public:
+        // With sort_by_material, hits are binned by material type before shading and every bin runs a non-virtual kernel.
+        // With lights, every shaded hit also takes a direct light sample (next event estimation).
+        // With caustics, hits with a density add the photon map's estimate and emitters found through a specular chain
+        // after such a hit are skipped.
+        wavefront_integrator(objs& scene, const color& background, int max_depth, int rr_start_depth, bool sort_by_material = true,
+                             const light_list* lights = nullptr, const photon_map* caustics = nullptr);
+
+        // Traces every ray of the batch to completion. radiance[i] receives the estimate of primary ray i
+        // and, if aovs is given, (*aovs)[i] its first-hit data.
+        void trace(const ray_batch& primary, std::vector<color>& radiance, std::vector<aov_sample>* aovs = nullptr);
+
+    private:
+        objs&   scene;
+        color   background;
+        int     max_depth;
+        int     rr_start_depth;
+        bool    sort_by_material;
+        const light_list* lights;
+        const photon_map* caustics;
+
+        // Queues reused across calls
+        path_queue                  paths;
+        std::vector<int>            active;         // Ids of the paths still being traced
+        std::vector<int>            next_active;
+        std::vector<hit_history>    hits;           // Parallel to active
+        std::vector<unsigned char>  hit_found;
+
+        // Queue positions (into active / hits) of the hits to shade, one bin per material type
+        std::vector<int>            bins[static_cast<int>(material_type::count)];
+
+        void extend();
+        void shade();
+        void shade_sorted();
+
+        // Adds a miss or an emitter hit to the path's radiance. Returns true when the path ends here.
+        bool terminate_at(int k);
+
+        // Specialized kernel over one material bin
+        template <class Material>
+        void shade_bin(const std::vector<int>& bin);
+
+        // Adds the direct light sample of the hit at queue position k to its path, and the caustic estimate if any
+        void connect_lights(int k);
+
+        // Applies the scattering result (sampled with density pdf, or specularly, at a surface with the given normal)
+        // to path p, runs Russian roulette and requeues survivors
+        void continue_path(int p, const vec3& attenuation, const ray& secondary, Real pdf, bool specular, const vec3& normal);
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "guiding.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    Real component(const vec3& v, int axis) {
+        return axis == 0 ? v.x() : (axis == 1 ? v.y() : v.z());
+    }
+
+    // Lock-free float accumulation (std::atomic<float>::fetch_add is C++20)
+    void atomic_add(std::atomic<float>& target, float value) {
+        float current = target.load(std::memory_order_relaxed);
+        while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+        }
+    }
+
+    constexpr Real bin_solid_angle = 4 * M_PI / path_guide::bins;
+}
+
+path_guide::leaf_data::leaf_data() : deposits(new std::atomic<float>[bins]) {
+    for (int b = 0; b < bins; b++) {
+        deposits[b].store(0.0f, std::memory_order_relaxed);
+        bin_pdf[b] = 0;
+    }
+}
+
+path_guide::path_guide(const AABB& bounds, const guide_settings& settings) : settings(settings), bounds(bounds) {
+    nodes.emplace_back();
+    nodes[0].leaf = 0;
+    node_bounds.push_back(bounds);
+    leaves.push_back(std::make_unique<leaf_data>());
+    leaf_node.push_back(0);
+}
+
+int path_guide::locate(const vec3& p) const {
+    int i = 0;
+    while (nodes[i].child[0] >= 0) {
+        i = component(p, nodes[i].axis) < nodes[i].split ? nodes[i].child[0] : nodes[i].child[1];
+    }
+    return nodes[i].leaf;
+}
+
+bool path_guide::trained(int leaf) const {
+    return !leaves[leaf]->cdf.empty();
+}
+
+int path_guide::bin_of(const vec3& dir) {
+    // Equal-area map: cos theta (here the z component) and phi are both uniform over the sphere
+    vec3 d = dir.unit_vector();
+    Real z = std::clamp(d.z(), Real(-1), Real(1));
+    Real phi = std::atan2(d.y(), d.x());
+    if (phi < 0) {
+        phi += 2 * M_PI;
+    }
+    int row = std::min(rows - 1, static_cast<int>((z + 1) / 2 * rows));
+    int column = std::min(columns - 1, static_cast<int>(phi / (2 * M_PI) * columns));
+    return row * columns + column;
+}
+
+vec3 path_guide::sample(int leaf, Real u1, Real u2) const {
+    const auto& cdf = leaves[leaf]->cdf;
+
+    // Bin by inverting the CDF, then u1 is reused for the position inside the bin
+    int b = static_cast<int>(std::upper_bound(cdf.begin(), cdf.end(), static_cast<float>(u1)) - cdf.begin());
+    b = std::min(b, bins - 1);
+    Real lo = b > 0 ? cdf[b - 1] : 0;
+    Real width = cdf[b] - lo;
+    Real ur = width > 0 ? std::clamp((u1 - lo) / width, Real(0), Real(1)) : Real(0.5);
+
+    Real z = -1 + 2 * ((b / columns) + ur) / rows;
+    Real phi = 2 * M_PI * ((b % columns) + u2) / columns;
+    Real r = std::sqrt(std::fmax(Real(0), 1 - z * z));
+    return vec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+Real path_guide::pdf(int leaf, const vec3& dir) const {
+    return leaves[leaf]->bin_pdf[bin_of(dir)];
+}
+
+void path_guide::record(int leaf, const vec3& dir, Real value) {
+    if (!(value > 0) || !std::isfinite(value)) {
+        return;
+    }
+    auto& l = *leaves[leaf];
+    atomic_add(l.deposits[bin_of(dir)], static_cast<float>(value));
+    l.records.fetch_add(1, std::memory_order_relaxed);
+}
+
+void path_guide::update() {
+    // Deposits to distributions. Leaves that received nothing keep what they had.
+    std::vector<unsigned int> records(leaves.size());
+    for (size_t li = 0; li < leaves.size(); li++) {
+        auto& l = *leaves[li];
+        double total = 0;
+        for (int b = 0; b < bins; b++) {
+            total += l.deposits[b].load(std::memory_order_relaxed);
+        }
+        if (total > 0 && std::isfinite(total)) {
+            l.cdf.resize(bins);
+            double running = 0;
+            for (int b = 0; b < bins; b++) {
+                double p = l.deposits[b].load(std::memory_order_relaxed) / total;
+                running += p;
+                l.cdf[b] = static_cast<float>(running);
+                l.bin_pdf[b] = static_cast<float>(p / bin_solid_angle);
+            }
+            l.cdf[bins - 1] = 1.0f;
+        }
+
+        records[li] = l.records.load(std::memory_order_relaxed);
+        for (int b = 0; b < bins; b++) {
+            l.deposits[b].store(0.0f, std::memory_order_relaxed);
+        }
+        l.records.store(0, std::memory_order_relaxed);
+    }
+
+    // Split busy leaves, assuming their deposits halve with every level
+    const size_t leaf_total = leaves.size();
+    for (size_t li = 0; li < leaf_total; li++) {
+        std::vector<std::pair<int, double>> pending = {{leaf_node[li], static_cast<double>(records[li])}};
+        while (!pending.empty()) {
+            auto [index, count] = pending.back();
+            pending.pop_back();
+            if (count <= settings.split_threshold || nodes[index].level >= settings.max_depth) {
+                continue;
+            }
+            split(index);
+            pending.emplace_back(nodes[index].child[0], count / 2);
+            pending.emplace_back(nodes[index].child[1], count / 2);
+        }
+    }
+}
+
+void path_guide::split(int index) {
+    const AABB box = node_bounds[index];
+    vec3 extent = box.get_hi() - box.get_lo();
+    int axis = extent.x() >= extent.y() && extent.x() >= extent.z() ? 0 : (extent.y() >= extent.z() ? 1 : 2);
+    Real middle = (component(box.get_lo(), axis) + component(box.get_hi(), axis)) / 2;
+
+    vec3 left_hi = box.get_hi();
+    vec3 right_lo = box.get_lo();
+    left_hi = vec3(axis == 0 ? middle : left_hi.x(), axis == 1 ? middle : left_hi.y(), axis == 2 ? middle : left_hi.z());
+    right_lo = vec3(axis == 0 ? middle : right_lo.x(), axis == 1 ? middle : right_lo.y(), axis == 2 ? middle : right_lo.z());
+
+    // The left child keeps the leaf, the right one gets a copy of its distribution
+    int old_leaf = nodes[index].leaf;
+    int new_leaf = static_cast<int>(leaves.size());
+    leaves.push_back(std::make_unique<leaf_data>());
+    leaves[new_leaf]->cdf = leaves[old_leaf]->cdf;
+    std::copy(leaves[old_leaf]->bin_pdf, leaves[old_leaf]->bin_pdf + bins, leaves[new_leaf]->bin_pdf);
+
+    int level = nodes[index].level + 1;
+    int left = static_cast<int>(nodes.size());
+    int right = left + 1;
+    nodes.resize(nodes.size() + 2);
+    node_bounds.push_back(AABB(box.get_lo(), left_hi));
+    node_bounds.push_back(AABB(right_lo, box.get_hi()));
+    nodes[left].leaf = old_leaf;
+    nodes[left].level = level;
+    nodes[right].leaf = new_leaf;
+    nodes[right].level = level;
+    leaf_node[old_leaf] = left;
+    leaf_node.push_back(right);
+
+    nodes[index].child[0] = left;
+    nodes[index].child[1] = right;
+    nodes[index].axis = axis;
+    nodes[index].split = middle;
+    nodes[index].leaf = -1;
+    tree_depth = std::max(tree_depth, level);
+}
+
+int path_guide::leaf_count() const {
+    return static_cast<int>(leaves.size());
+}
+
+int path_guide::depth() const {
+    return tree_depth;
+}
+
+const guide_settings& path_guide::get_settings() const {
+    return settings;
+}
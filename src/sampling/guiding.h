@@ -0,0 +1,92 @@
+#ifndef GUIDING_H
+#define GUIDING_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include "../vec3.h"
+#include "../objects/bvh/aabb.h"
+
+/*
+    Path guiding (after Mueller et al. 2017, "Practical Path Guiding"). A binary tree splits the scene bounds,
+    each node at the middle of its box's longest axis; every leaf holds a histogram of the radiance arriving from
+    each direction, over an equal-area (cos theta, phi) grid of the sphere.
+
+    Rendering alternates between passes and updates. During a training pass every path vertex at a surface with a
+    density deposits the radiance it received along its sampled direction, divided by that direction's density,
+    into the bin of its leaf: lock-free, with atomic adds, from all threads at once. The update between passes
+    turns the deposits into the sampling distribution of each leaf and splits leaves that saw many deposits, so
+    the tree gets finer where paths go. Later passes sample a mix of the learned distribution and the BSDF.
+
+    The tree and the sampling distributions only change in update, which must not run concurrently with rendering.
+*/
+
+struct guide_settings {
+    int     training_passes = 4;        // Progressive passes that feed the guide; later passes only use it
+    Real    guided_fraction = 0.5;      // Probability of sampling the guide rather than the BSDF at a vertex
+    int     split_threshold = 4000;     // Deposits after which a leaf is split in two
+    int     max_depth       = 24;       // Of the spatial tree
+};
+
+class path_guide {
+    public:
+        // Directional grid resolution: rows of equal cos theta times columns of equal phi
+        static constexpr int rows = 16;
+        static constexpr int columns = 32;
+        static constexpr int bins = rows * columns;
+
+        explicit path_guide(const AABB& bounds, const guide_settings& settings = guide_settings());
+
+        // Leaf whose region holds p (points outside the bounds go to the nearest leaf)
+        int     locate(const vec3& p) const;
+
+        // Whether the leaf has a sampling distribution yet
+        bool    trained(int leaf) const;
+
+        // Direction from the leaf's learned distribution, and the solid-angle density of the distribution at dir
+        vec3    sample(int leaf, Real u1, Real u2) const;
+        Real    pdf(int leaf, const vec3& dir) const;
+
+        // Deposits radiance over density for the direction. Safe to call from any number of threads.
+        void    record(int leaf, const vec3& dir, Real value);
+
+        // Between passes: deposits become the sampling distributions, busy leaves are split, deposits are cleared
+        void    update();
+
+        int     leaf_count() const;
+        int     depth() const;
+        const guide_settings& get_settings() const;
+
+    private:
+        struct node {
+            int     child[2]    = {-1, -1};     // Both -1 at leaves
+            int     axis        = 0;
+            Real    split       = 0;
+            int     leaf        = -1;           // Leaves only: index into leaves
+            int     level       = 1;
+        };
+
+        struct leaf_data {
+            std::unique_ptr<std::atomic<float>[]>   deposits;       // One per bin
+            std::atomic<unsigned int>               records{0};
+            std::vector<float>                      cdf;            // Empty until trained
+            float                                   bin_pdf[bins];  // Solid-angle density inside each bin
+
+            leaf_data();
+        };
+
+        guide_settings                          settings;
+        AABB                                    bounds;
+        std::vector<node>                       nodes;          // Root first
+        std::vector<AABB>                       node_bounds;
+        std::vector<std::unique_ptr<leaf_data>> leaves;
+        std::vector<int>                        leaf_node;      // Node of every leaf
+        int                                     tree_depth  = 1;
+
+        static int  bin_of(const vec3& dir);
+
+        // Splits node (a leaf) at the middle of its box's longest axis, handing the leaf's distribution to both children
+        void        split(int index);
+};
+
+#endif
@@ -0,0 +1,283 @@
+#include "lights.h"
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    Real safe_acos(Real x) {
+        return std::acos(std::clamp(x, Real(-1), Real(1)));
+    }
+
+    vec3 box_center(const AABB& box) {
+        return (box.get_lo() + box.get_hi()) / 2;
+    }
+
+    // Rotates v by angle around the unit axis k (Rodrigues)
+    vec3 rotate_about(vec3 v, vec3 k, Real angle) {
+        Real c = std::cos(angle);
+        Real s = std::sin(angle);
+        return v * c + cross(k, v) * s + k * ((k * v) * (1 - c));
+    }
+
+    // Smallest cone holding the cones (axis_a, theta_a) and (axis_b, theta_b), written to a (PBRT-v4 DirectionCone::Union)
+    void merge_cones(vec3& axis_a, Real& cos_a, vec3 axis_b, Real cos_b) {
+        Real theta_a = safe_acos(cos_a);
+        Real theta_b = safe_acos(cos_b);
+        Real theta_d = safe_acos(axis_a * axis_b);
+        if (std::fmin(theta_d + theta_b, M_PI) <= theta_a) {
+            return;
+        }
+        if (std::fmin(theta_d + theta_a, M_PI) <= theta_b) {
+            axis_a = axis_b;
+            cos_a = cos_b;
+            return;
+        }
+
+        Real theta_o = (theta_a + theta_d + theta_b) / 2;
+        vec3 k = cross(axis_a, axis_b);
+        if (theta_o >= M_PI || k * k == 0) {
+            cos_a = -1;
+            return;
+        }
+        axis_a = rotate_about(axis_a, k.unit_vector(), theta_o - theta_a).unit_vector();
+        cos_a = std::cos(theta_o);
+    }
+
+    emitter_bounds merge(const emitter_bounds& a, const emitter_bounds& b) {
+        emitter_bounds m = a;
+        m.box = AABB(a.box, b.box);
+        m.power = a.power + b.power;
+        merge_cones(m.axis, m.cos_theta_o, b.axis, b.cos_theta_o);
+        m.cos_theta_e = std::fmin(a.cos_theta_e, b.cos_theta_e);
+        return m;
+    }
+
+    // Conservative estimate of the light the bounds send to point p with surface normal n: the power over the squared
+    // distance, times the cosines of the smallest angles the box and cones allow at the light and at p (PBRT-v4 LightBounds::Importance)
+    Real importance(const emitter_bounds& b, const vec3& p, const vec3& n) {
+        if (b.power <= 0) {
+            return 0;
+        }
+
+        vec3 to_p = p - box_center(b.box);
+        Real radius2 = (b.box.get_hi() - b.box.get_lo()) * (b.box.get_hi() - b.box.get_lo()) / 4;
+        Real dist2 = to_p * to_p;
+        Real dist = std::sqrt(dist2);
+        vec3 wi = dist > 0 ? to_p / dist : vec3(0, 0, 1);
+
+        // Half angle the box subtends from p (everything when p is inside its bounding sphere)
+        Real theta_b = dist2 <= radius2 ? M_PI : std::asin(std::sqrt(radius2 / dist2));
+
+        // At the light: how far wi lies outside the emission cone, given the box's extent
+        Real theta_w = safe_acos(b.axis * wi);
+        Real theta = std::fmax(Real(0), theta_w - safe_acos(b.cos_theta_o) - theta_b);
+        if (theta >= safe_acos(b.cos_theta_e)) {
+            return 0;
+        }
+
+        // At p: the cosine with the surface normal, either side
+        Real theta_i = safe_acos(std::fabs(wi * n));
+        Real cos_i = std::cos(std::fmax(Real(0), theta_i - theta_b));
+
+        return b.power * std::cos(theta) * cos_i / std::fmax(dist2, radius2);
+    }
+}
+
+void light_list::build(const objs& scene) {
+    std::vector<const objs*> emitters;
+    scene.collect_emitters(emitters);
+
+    std::vector<std::pair<const objs*, emitter_bounds>> lights;
+    for (const objs* e : emitters) {
+        lights.emplace_back(e, e->get_emitter_bounds());
+    }
+
+    nodes.clear();
+    leaf_of.clear();
+    tree_depth = 0;
+    if (!lights.empty()) {
+        build_node(lights, 0, static_cast<int>(lights.size()), -1, 1);
+    }
+}
+
+int light_list::build_node(std::vector<std::pair<const objs*, emitter_bounds>>& lights, int lo, int hi, int parent, int level) {
+    int index = static_cast<int>(nodes.size());
+    nodes.emplace_back();
+    nodes[index].parent = parent;
+    tree_depth = std::max(tree_depth, level);
+
+    if (hi - lo == 1) {
+        nodes[index].bounds = lights[lo].second;
+        nodes[index].emitter = lights[lo].first;
+        leaf_of[lights[lo].first] = index;
+        return index;
+    }
+
+    // Median split of the box centers along their widest axis
+    AABB centers;
+    for (int i = lo; i < hi; i++) {
+        vec3 c = box_center(lights[i].second.box);
+        centers = AABB(centers, AABB(c, c));
+    }
+    vec3 extent = centers.get_hi() - centers.get_lo();
+    int axis = extent.x() >= extent.y() && extent.x() >= extent.z() ? 0 : (extent.y() >= extent.z() ? 1 : 2);
+    auto coordinate = [axis](const vec3& v) { return axis == 0 ? v.x() : (axis == 1 ? v.y() : v.z()); };
+
+    int mid = lo + (hi - lo) / 2;
+    std::nth_element(lights.begin() + lo, lights.begin() + mid, lights.begin() + hi,
+                     [&](const std::pair<const objs*, emitter_bounds>& a, const std::pair<const objs*, emitter_bounds>& b) {
+                         return coordinate(box_center(a.second.box)) < coordinate(box_center(b.second.box));
+                     });
+
+    int left = build_node(lights, lo, mid, index, level + 1);
+    int right = build_node(lights, mid, hi, index, level + 1);
+    nodes[index].child[0] = left;
+    nodes[index].child[1] = right;
+    nodes[index].bounds = merge(nodes[left].bounds, nodes[right].bounds);
+    return index;
+}
+
+bool light_list::empty() const {
+    return nodes.empty();
+}
+
+int light_list::size() const {
+    return static_cast<int>(leaf_of.size());
+}
+
+int light_list::depth() const {
+    return tree_depth;
+}
+
+int light_list::pick(const vec3& p, const vec3& n, Real u, Real& pmf) const {
+    pmf = 1;
+    int i = 0;
+    while (nodes[i].child[0] >= 0) {
+        Real w0 = importance(nodes[nodes[i].child[0]].bounds, p, n);
+        Real w1 = importance(nodes[nodes[i].child[1]].bounds, p, n);
+        if (w0 + w1 <= 0) {
+            return -1;
+        }
+
+        // Pick a child and rescale u for the next level
+        Real p0 = w0 / (w0 + w1);
+        if (u < p0) {
+            i = nodes[i].child[0];
+            pmf *= p0;
+            u = u / p0;
+        } else {
+            i = nodes[i].child[1];
+            pmf *= 1 - p0;
+            u = (u - p0) / (1 - p0);
+        }
+        u = std::fmin(u, Real(1) - std::numeric_limits<Real>::epsilon());
+    }
+    return i;
+}
+
+Real light_list::pick_pmf(const vec3& p, const vec3& n, const objs* emitter) const {
+    auto leaf = leaf_of.find(emitter);
+    if (leaf == leaf_of.end()) {
+        return 0;
+    }
+
+    // Walk up, multiplying the probability of every choice on the way down
+    Real pmf = 1;
+    for (int i = leaf->second; nodes[i].parent >= 0; i = nodes[i].parent) {
+        const auto& parent = nodes[nodes[i].parent];
+        Real w0 = importance(nodes[parent.child[0]].bounds, p, n);
+        Real w1 = importance(nodes[parent.child[1]].bounds, p, n);
+        if (w0 + w1 <= 0) {
+            return 0;
+        }
+        pmf *= (i == parent.child[0] ? w0 : w1) / (w0 + w1);
+    }
+    return pmf;
+}
+
+color light_list::sample_direct(objs& scene, const hit_history& hist) const {
+    const material* mat = hist.material_.get();
+    return sample_direct_with(scene, hist, [&](const vec3& wi) { return mat->pdf(wi, hist.normal); });
+}
+
+color light_list::sample_direct(objs& scene, const hit_history& hist, const std::function<Real(const vec3&)>& scatter_pdf) const {
+    return sample_direct_with(scene, hist, scatter_pdf);
+}
+
+template <class ScatterPdf>
+color light_list::sample_direct_with(objs& scene, const hit_history& hist, const ScatterPdf& scatter_pdf) const {
+    const material* mat = hist.material_.get();
+    if (nodes.empty() || !mat->has_density()) {
+        return color(0, 0, 0);
+    }
+
+    // Pick an emitter by its estimated contribution, then a point on it
+    Real select_pmf;
+    int leaf = pick(hist.intersection, hist.normal, utils::random_double(0, 1), select_pmf);
+    if (leaf < 0) {
+        return color(0, 0, 0);
+    }
+    const objs* light = nodes[leaf].emitter;
+    emitter_sample s = light->sample_emitter(hist.intersection, utils::random_double(0, 1), utils::random_double(0, 1));
+    if (s.pdf <= 0) {
+        return color(0, 0, 0);
+    }
+
+    vec3 to_light = s.point - hist.intersection;
+    Real dist = to_light.magnitude();
+    if (dist <= 0) {
+        return color(0, 0, 0);
+    }
+    vec3 wi = to_light / dist;
+
+    color f = mat->eval(wi, hist.normal, hist.u, hist.v, hist.intersection);
+    if (max_component(f) <= 0) {
+        return color(0, 0, 0);
+    }
+
+    // Shadow ray, stopping just short of the light
+    hit_history blocker;
+    if (scene.ray_hit(ray(hist.intersection, wi), 1e-4, dist * (1 - 1e-4), blocker)) {
+        return color(0, 0, 0);
+    }
+
+    Real light_pdf = select_pmf * s.pdf;
+    Real weight = power_heuristic(light_pdf, scatter_pdf(wi));
+    return hadamard(f, light->get_material()->emit(s.point)) * (weight / light_pdf);
+}
+
+Real light_list::emission_weight(const vec3& from, const vec3& from_normal, Real material_pdf, const hit_history& hist) const {
+    if (hist.object == nullptr) {
+        return 1;
+    }
+    Real light_pdf = pick_pmf(from, from_normal, hist.object) * hist.object->emitter_pdf(from, hist.intersection, hist.normal);
+    return power_heuristic(material_pdf, light_pdf);
+}
+
+light_candidate light_list::sample_point(const vec3& p, const vec3& n, Real u0, Real u1, Real u2) const {
+    light_candidate c;
+    if (nodes.empty()) {
+        return c;
+    }
+
+    Real select_pmf;
+    int leaf = pick(p, n, u0, select_pmf);
+    if (leaf < 0) {
+        return c;
+    }
+    const objs* light = nodes[leaf].emitter;
+    emitter_sample s = light->sample_emitter(p, u1, u2);
+    vec3 to_light = s.point - p;
+    Real dist2 = to_light * to_light;
+    if (s.pdf <= 0 || dist2 <= 0) {
+        return c;
+    }
+
+    // Solid angle to area: dw = |cos_light| dA / dist^2
+    Real cos_light = std::fabs(s.normal * to_light) / std::sqrt(dist2);
+    c.emitter = light;
+    c.point = s.point;
+    c.normal = s.normal;
+    c.pdf_area = select_pmf * s.pdf * cos_light / dist2;
+    return c;
+}
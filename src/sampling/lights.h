@@ -0,0 +1,86 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include "../color.h"
+#include "../objects/objs.h"
+
+/*
+    Direct light sampling (next event estimation). The emissive primitives of the scene are gathered into
+    a list; at every hit on a material with a density (see material::has_density) one of them is sampled,
+    a shadow ray connects to it, and the result is combined with the material's own sampling by multiple
+    importance sampling (power heuristic), so that neither small bright lights nor large dim ones are noisy.
+
+    Lights are picked through a light BVH (Conty Estevez & Kulla 2018): every node bounds the position,
+    emission cone and power of the emitters below it, and the descent picks each child with probability
+    proportional to an estimate of its contribution at the shading point. Picking one light, or computing the
+    probability of having picked it, costs one root-to-leaf walk.
+*/
+
+// Point on an emitter drawn for resampled direct lighting (see restir.h), with its density per unit area of the
+// emitter. Area densities stay valid when the sample is reused at another shading point.
+struct light_candidate {
+    const objs* emitter     = nullptr;
+    vec3        point;
+    vec3        normal;
+    Real        pdf_area    = 0;        // Light pick times point density; 0 for no usable sample
+};
+
+class light_list {
+    public:
+        // Gathers the emitters below scene and builds the hierarchy over them
+        void    build(const objs& scene);
+
+        bool    empty() const;
+        int     size() const;
+        int     depth() const;
+
+        // One-sample estimate of the light reaching a hit directly from the emitters, weighted against
+        // material sampling. Zero for materials without a density.
+        color   sample_direct(objs& scene, const hit_history& hist) const;
+        // The same at a hit whose next direction is drawn with density scatter_pdf(wi) instead of the material's own
+        // (a guided mixture, see guiding.h), so that the MIS weight matches the one the scattered ray gets
+        color   sample_direct(objs& scene, const hit_history& hist, const std::function<Real(const vec3&)>& scatter_pdf) const;
+
+        // Weight of emission found by a material-sampled ray leaving from (with surface normal from_normal) with density
+        // material_pdf and hitting the emitter in hist: the counterpart of the weight sample_direct gives the same connection.
+        Real    emission_weight(const vec3& from, const vec3& from_normal, Real material_pdf, const hit_history& hist) const;
+
+        // Picks an emitter and a point on it for the shading point p with normal n, like sample_direct does, without tracing anything
+        light_candidate sample_point(const vec3& p, const vec3& n, Real u0, Real u1, Real u2) const;
+
+    private:
+        struct light_node {
+            emitter_bounds  bounds;
+            int             child[2]    = {-1, -1};     // Both -1 at leaves
+            int             parent      = -1;
+            const objs*     emitter     = nullptr;      // Leaves only
+        };
+
+        std::vector<light_node>                 nodes;          // Root first
+        std::unordered_map<const objs*, int>    leaf_of;
+        int                                     tree_depth  = 0;
+
+        int     build_node(std::vector<std::pair<const objs*, emitter_bounds>>& lights, int lo, int hi, int parent, int level);
+
+        // Descends from the root, picking children by importance. Returns the leaf and its probability (-1 if nothing contributes).
+        int     pick(const vec3& p, const vec3& n, Real u, Real& pmf) const;
+
+        // Probability of pick choosing the emitter
+        Real    pick_pmf(const vec3& p, const vec3& n, const objs* emitter) const;
+
+        // sample_direct with the scattering density as a parameter
+        template <class ScatterPdf>
+        color   sample_direct_with(objs& scene, const hit_history& hist, const ScatterPdf& scatter_pdf) const;
+};
+
+// Power heuristic (beta = 2) weight of a strategy with density pdf_a against one with density pdf_b
+inline Real power_heuristic(Real pdf_a, Real pdf_b) {
+    Real a2 = pdf_a * pdf_a;
+    Real b2 = pdf_b * pdf_b;
+    return a2 + b2 > 0 ? a2 / (a2 + b2) : 0;
+}
+
+#endif
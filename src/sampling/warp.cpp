@@ -0,0 +1,35 @@
+#include "warp.h"
+
+// The batched kernels below avoid vec3 temporaries so the compiler can keep every lane in registers.
+
+void warp::uniform_sphere_n(const Real* u1, const Real* u2, Real* x, Real* y, Real* z, int n) {
+    for (int i = 0; i < n; i++) {
+        Real zi = 1.0 - 2.0 * u1[i];
+        Real r = std::sqrt(std::fmax(0.0, 1.0 - zi * zi));
+        Real phi = 2.0 * M_PI * u2[i];
+        x[i] = r * std::cos(phi);
+        y[i] = r * std::sin(phi);
+        z[i] = zi;
+    }
+}
+
+void warp::concentric_disk_n(const Real* u1, const Real* u2, Real* x, Real* y, int n) {
+    for (int i = 0; i < n; i++) {
+        Real a = 2.0 * u1[i] - 1.0;
+        Real b = 2.0 * u2[i] - 1.0;
+        bool   wide = std::fabs(a) > std::fabs(b);
+        Real r    = wide ? a : b;
+        Real num  = wide ? b : a;
+        Real den  = (r == 0.0) ? 1.0 : r;
+        Real phi  = wide ? (M_PI / 4) * (num / den) : (M_PI / 2) - (M_PI / 4) * (num / den);
+        x[i] = r * std::cos(phi);
+        y[i] = r * std::sin(phi);
+    }
+}
+
+void warp::cosine_hemisphere_n(const Real* u1, const Real* u2, Real* x, Real* y, Real* z, int n) {
+    concentric_disk_n(u1, u2, x, y, n);
+    for (int i = 0; i < n; i++) {
+        z[i] = std::sqrt(std::fmax(0.0, 1.0 - x[i] * x[i] - y[i] * y[i]));
+    }
+}
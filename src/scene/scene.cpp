@@ -0,0 +1,222 @@
+#include "scene.h"
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+#include "../objects/sphere.h"
+#include "../objects/quad.h"
+#include "../objects/bvh/bvh.h"
+#include "../material/diffuse.h"
+#include "../material/metal.h"
+#include "../material/dielectric.h"
+#include "../material/bulb.h"
+#include "../texture/texture.h"
+
+void scene_desc::set_material(const material_desc& desc) {
+    auto it = std::find_if(materials.begin(), materials.end(), [&](const material_desc& m) { return m.name == desc.name; });
+    if (it != materials.end()) {
+        *it = desc;
+    } else {
+        materials.push_back(desc);
+    }
+}
+
+void scene_desc::set_object(const object_desc& desc) {
+    auto it = std::find_if(objects.begin(), objects.end(), [&](const object_desc& o) { return o.name == desc.name; });
+    if (it != objects.end()) {
+        *it = desc;
+    } else {
+        objects.push_back(desc);
+    }
+}
+
+namespace {
+    // Largest image side a scene may ask for; the frame buffers are sized from it before anything else is checked
+    constexpr int max_image_side = 16384;
+
+    std::string token(const std::string& name) {
+        std::string t = name.empty() ? "_" : name;
+        std::replace_if(t.begin(), t.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }, '_');
+        return t;
+    }
+
+    std::ostream& operator<<(std::ostream& out, const vec3& v) {
+        return out << v.x() << ' ' << v.y() << ' ' << v.z();
+    }
+
+    bool read_vec(std::istream& in, vec3& v) {
+        Real x, y, z;
+        if (!(in >> x >> y >> z)) {
+            return false;
+        }
+        v = vec3(x, y, z);
+        return true;
+    }
+}
+
+namespace scene {
+    shared_ptr<material> make_material(const material_desc& desc) {
+        if (desc.type == "metal") {
+            return desc.param ? make_shared<metal>(desc.albedo, desc.param) : make_shared<metal>(desc.albedo);
+        } else if (desc.type == "dielectric") {
+            return make_shared<dielectric>(desc.param);
+        } else if (desc.type == "bulb") {
+            return make_shared<Bulb>(desc.albedo);
+        } else if (desc.type == "texture") {
+            return make_shared<diffuse>(make_shared<ImageTexture>(desc.texture));
+        }
+        return make_shared<diffuse>(desc.albedo);
+    }
+
+    shared_ptr<world> box(const vec3& a, const vec3& b, shared_ptr<material> mat) {
+        // Returns the 3D box containing the two opposite vertices a & b.
+        auto sides = make_shared<world>();
+        auto min = vec3(std::fmin(a.x(),b.x()), std::fmin(a.y(),b.y()), std::fmin(a.z(),b.z()));
+        auto max = vec3(std::fmax(a.x(),b.x()), std::fmax(a.y(),b.y()), std::fmax(a.z(),b.z()));
+
+        auto dx = vec3(max.x() - min.x(), 0, 0);
+        auto dy = vec3(0, max.y() - min.y(), 0);
+        auto dz = vec3(0, 0, max.z() - min.z());
+
+        sides->insert(make_shared<Quad>(vec3(min.x(), min.y(), max.z()),  dx,  dy, mat));       // front
+        sides->insert(make_shared<Quad>(vec3(max.x(), min.y(), max.z()), -1 * dz,  dy, mat));   // right
+        sides->insert(make_shared<Quad>(vec3(max.x(), min.y(), min.z()), -1 * dx,  dy, mat));   // back
+        sides->insert(make_shared<Quad>(vec3(min.x(), min.y(), min.z()),  dz,  dy, mat));       // left
+        sides->insert(make_shared<Quad>(vec3(min.x(), max.y(), max.z()),  dx, -1 * dz, mat));   // top
+        sides->insert(make_shared<Quad>(vec3(min.x(), min.y(), min.z()),  dx,  dz, mat));       // bottom
+
+        return sides;
+    }
+
+    shared_ptr<objs> make_object(const object_desc& desc, shared_ptr<material> mat) {
+        shared_ptr<objs> object;
+        if (desc.type == "quad") {
+            object = make_shared<Quad>(desc.position, desc.u, desc.v, mat);
+        } else if (desc.type == "box") {
+            object = box(desc.position, desc.position2, mat);
+        } else {
+            object = make_shared<sphere>(desc.radius, desc.position, mat);
+        }
+        object->rotate(desc.x_rotation, 'x');
+        object->rotate(desc.y_rotation, 'y');
+        return object;
+    }
+
+    world build_world(const scene_desc& desc) {
+        world list;
+        for (const auto& o : desc.objects) {
+            auto m = std::find_if(desc.materials.begin(), desc.materials.end(), [&](const material_desc& md) { return md.name == o.material; });
+            if (m == desc.materials.end()) {
+                throw std::runtime_error("object " + o.name + " uses unknown material " + o.material);
+            }
+
+            auto object = make_object(o, make_material(*m));
+            if (auto complex_object = std::dynamic_pointer_cast<world>(object)) {
+                for (const auto& part : complex_object->objects) {
+                    list.insert(part);
+                }
+            } else {
+                list.insert(object);
+            }
+        }
+
+        // Refrain from applying BVH to empty world
+        if (list.objects.empty()) {
+            return list;
+        }
+        return world(make_shared<BoundingVolumeNode>(list));
+    }
+
+    std::string to_text(const scene_desc& desc) {
+        std::ostringstream out;
+        out.precision(17);
+        const auto& s = desc.settings;
+        out << "# Tracey scene\n";
+        out << "settings " << s.width << ' ' << s.height << ' ' << s.fov << ' ' << s.dof_angle << ' '
+            << s.aa_factor << ' ' << s.max_depth << ' ' << s.engine << ' ' << s.light_sampling << '\n';
+        out << "background " << s.background << '\n';
+        out << "view " << s.camera_position << ' ' << s.lookat << '\n';
+
+        for (const auto& m : desc.materials) {
+            out << "material " << token(m.name) << ' ' << m.type << ' ' << m.albedo << ' ' << m.param;
+            if (m.type == "texture") {
+                out << ' ' << m.texture;
+            }
+            out << '\n';
+        }
+        for (const auto& o : desc.objects) {
+            out << "object " << token(o.name) << ' ' << o.type << ' ' << token(o.material) << ' ' << o.position << ' ' << o.radius << ' '
+                << o.u << ' ' << o.v << ' ' << o.position2 << ' ' << o.x_rotation << ' ' << o.y_rotation << '\n';
+        }
+        return out.str();
+    }
+
+    scene_desc from_text(const std::string& text) {
+        scene_desc desc;
+        std::istringstream in(text);
+        std::string line;
+        int line_number = 0;
+
+        while (std::getline(in, line)) {
+            line_number++;
+            std::istringstream fields(line);
+            std::string kind;
+            if (!(fields >> kind) || kind[0] == '#') {
+                continue;
+            }
+
+            bool ok = true;
+            auto& s = desc.settings;
+            if (kind == "settings") {
+                ok = static_cast<bool>(fields >> s.width >> s.height >> s.fov >> s.dof_angle >> s.aa_factor >> s.max_depth >> s.engine)
+                     && s.width > 0 && s.height > 0 && s.width <= max_image_side && s.height <= max_image_side;
+                int light_sampling;
+                if (ok && fields >> light_sampling) {
+                    s.light_sampling = light_sampling != 0;
+                }
+            } else if (kind == "background") {
+                ok = read_vec(fields, s.background);
+            } else if (kind == "view") {
+                ok = read_vec(fields, s.camera_position) && read_vec(fields, s.lookat);
+            } else if (kind == "material") {
+                material_desc m;
+                ok = (fields >> m.name >> m.type) && read_vec(fields, m.albedo) && (fields >> m.param);
+                if (ok && m.type == "texture") {
+                    // The path is the rest of the line and may contain spaces
+                    std::getline(fields >> std::ws, m.texture);
+                }
+                desc.set_material(m);
+            } else if (kind == "object") {
+                object_desc o;
+                ok = (fields >> o.name >> o.type >> o.material) && read_vec(fields, o.position) && (fields >> o.radius)
+                     && read_vec(fields, o.u) && read_vec(fields, o.v) && read_vec(fields, o.position2)
+                     && (fields >> o.x_rotation >> o.y_rotation);
+                desc.set_object(o);
+            } else {
+                ok = false;
+            }
+
+            if (!ok) {
+                throw std::runtime_error("malformed scene line " + std::to_string(line_number) + ": " + line);
+            }
+        }
+        return desc;
+    }
+
+    bool save(const scene_desc& desc, const std::string& path) {
+        std::ofstream file(path);
+        file << to_text(desc);
+        return static_cast<bool>(file);
+    }
+
+    scene_desc load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("cannot open scene file " + path);
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return from_text(buffer.str());
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "../vec3.h"
+#include "../objects/world.h"
+#include "../material/material.h"
+
+/*
+    Plain description of a scene as it is built in the GUI, with a line-based text format so that
+    another process (e.g. a distributed render worker) can rebuild exactly the same world:
+
+        settings <width> <height> <fov> <dof angle> <aa factor> <max depth> <engine> [<light sampling 0/1>]
+        background <r> <g> <b>
+        view <camera x y z> <look at x y z>
+        material <name> <type> <r> <g> <b> <param> [texture path]
+        object <name> <type> <material> <x y z> <radius> <u x y z> <v x y z> <opposite x y z> <x rotation> <y rotation>
+
+    Names may not contain whitespace (it is replaced by '_' on save). Lines starting with '#' are comments.
+*/
+
+struct material_desc {
+    std::string name;
+    std::string type        = "diffuse";    // diffuse, metal, dielectric, bulb or texture
+    vec3        albedo      = vec3(0, 0, 0);
+    Real        param       = 0;            // Metal fuzziness or dielectric refraction index
+    std::string texture;                    // Image path of texture materials
+};
+
+struct object_desc {
+    std::string name;
+    std::string type        = "sphere";     // sphere, quad or box
+    std::string material;
+    vec3        position    = vec3(0, 0, 0);
+    Real        radius      = 0;            // Sphere only
+    vec3        u           = vec3(0, 0, 0);    // Quad only
+    vec3        v           = vec3(0, 0, 0);
+    vec3        position2   = vec3(0, 0, 0);    // Box only: the opposite vertex
+    Real        x_rotation  = 0;
+    Real        y_rotation  = 0;
+};
+
+struct render_settings {
+    int     width           = 800;
+    int     height          = 800;
+    Real    fov             = 20;
+    Real    dof_angle       = 0;
+    int     aa_factor       = 150;
+    int     max_depth       = 40;
+    int     engine          = 0;            // render_engine as int
+    bool    light_sampling  = true;
+    vec3    background      = vec3(0, 0, 0);
+    vec3    camera_position = vec3(0, 0, 0);
+    vec3    lookat          = vec3(0, 0, -100);
+};
+
+struct scene_desc {
+    render_settings             settings;
+    std::vector<material_desc>  materials;
+    std::vector<object_desc>    objects;
+
+    // Add, or replace the entry of the same name
+    void set_material(const material_desc& desc);
+    void set_object(const object_desc& desc);
+};
+
+namespace scene {
+    shared_ptr<material> make_material(const material_desc& desc);
+
+    // 3D box of six quads spanning the opposite vertices a and b
+    shared_ptr<world> box(const vec3& a, const vec3& b, shared_ptr<material> mat);
+
+    // Builds the object with its rotations applied. Boxes come back as a world of quads.
+    shared_ptr<objs> make_object(const object_desc& desc, shared_ptr<material> mat);
+
+    // Every object of the scene, with boxes flattened into their quads and a BVH on top
+    world build_world(const scene_desc& desc);
+
+    std::string to_text(const scene_desc& desc);
+    // Throws std::runtime_error naming the line of the first malformed entry (including an image size out of range)
+    scene_desc  from_text(const std::string& text);
+
+    bool        save(const scene_desc& desc, const std::string& path);
+    // Throws std::runtime_error when the file cannot be read or parsed
+    scene_desc  load(const std::string& path);
+}
+
+#endif
@@ -1,8 +1,8 @@
 #include "texture.h"
 
-DefaultTexture::DefaultTexture(double size, const vec3& a, const vec3& b) : boxsize(size), col_A(a), col_B(b) {}
+DefaultTexture::DefaultTexture(Real size, const vec3& a, const vec3& b) : boxsize(size), col_A(a), col_B(b) {}
 
-vec3 DefaultTexture::get_color_at(double u, double v, const vec3& point) const {
+vec3 DefaultTexture::get_color_at(Real u, Real v, const vec3& point) const {
     using std::floor;
     
     auto sum =  static_cast<int>(floor(point.x() / boxsize)) + 
@@ -21,7 +21,7 @@ vec3 DefaultTexture::get_color_at(double u, double v, const vec3& point) const {
 
 ImageTexture::ImageTexture(const std::string& fpath) : image(utils::load_texture(fpath)) {}
 
-vec3 ImageTexture::get_color_at(double u, double v, const vec3& point) const {
+vec3 ImageTexture::get_color_at(Real u, Real v, const vec3& point) const {
     if (image.data.empty()) {
         // If failed to load texture data, return magenta
         return vec3(1, 0, 1);
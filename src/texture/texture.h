@@ -14,17 +14,17 @@ class Texture {
         virtual ~Texture() = default;
 
         // Retrieves the color emitted by the texture at the specified uv coordinate
-        virtual vec3 get_color_at(double u, double v, const vec3& point) const = 0;
+        virtual vec3 get_color_at(Real u, Real v, const vec3& point) const = 0;
 };
 
 class DefaultTexture : public Texture {
     public:
-        DefaultTexture(double boxsize, const vec3& a, const vec3& b);
+        DefaultTexture(Real boxsize, const vec3& a, const vec3& b);
 
-        vec3 get_color_at(double u, double v, const vec3& point) const override;
+        vec3 get_color_at(Real u, Real v, const vec3& point) const override;
         
     private:
-        double boxsize;
+        Real boxsize;
         vec3 col_A;
         vec3 col_B;
 };
@@ -33,7 +33,7 @@ class ImageTexture : public Texture {
     public:
         ImageTexture(const std::string& fpath);
 
-        vec3 get_color_at(double u, double v, const vec3& point) const override;
+        vec3 get_color_at(Real u, Real v, const vec3& point) const override;
     private:
         Image image;
 };
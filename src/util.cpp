@@ -1,20 +1,75 @@
 #include "util.h"
+#include <limits>
+#include <algorithm>
 
-// double utils::random_double(double x, double y) {
+// Real utils::random_double(Real x, Real y) {
 //     static std::random_device rd;  // Seed
 //     static std::mt19937 gen(rd()); // Mersenne Twister engine
 //     std::uniform_real_distribution<> dis(x, y);
 //     return dis(gen);
 // }
 
-double utils::random_double(double x, double y) {
-    thread_local std::random_device rd;  // Seed (thread-local)
-    thread_local std::mt19937 gen(rd()); // Mersenne Twister engine (thread-local)
-    std::uniform_real_distribution<> dis(x, y);
-    return dis(gen);
+namespace {
+    // PCG32 (XSH RR): 64-bit state, 32-bit output. Much smaller and cheaper to reseed than std::mt19937.
+    struct pcg32 {
+        uint64_t state = 0x853c49e6748fea9bULL;
+        uint64_t inc   = 0xda3e39cb94b95bdbULL;
+
+        void seed(uint64_t seed_) {
+            state = 0;
+            next();
+            state += seed_;
+            next();
+        }
+
+        uint32_t next() {
+            uint64_t old = state;
+            state = old * 6364136223846793005ULL + inc;
+            uint32_t xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+            uint32_t rot = static_cast<uint32_t>(old >> 59);
+            return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+        }
+    };
+
+    pcg32& thread_rng() {
+        // Threads that never reseed still get independent streams
+        thread_local pcg32 rng = [] {
+            pcg32 r;
+            r.seed((static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}());
+            return r;
+        }();
+        return rng;
+    }
+}
+
+Real utils::random_double(Real x, Real y) {
+    auto& rng = thread_rng();
+    Real u;
+    if constexpr (config::single_precision) {
+        u = (rng.next() >> 8) * (1.0f / 16777216.0f);                                  // 24 bits
+    } else {
+        uint64_t bits = (static_cast<uint64_t>(rng.next()) << 32) | rng.next();
+        u = (bits >> 11) * (1.0 / 9007199254740992.0);                                 // 53 bits
+    }
+    return x + (y - x) * u;
+}
+
+void utils::seed_random(uint64_t seed) {
+    thread_rng().seed(seed);
+}
+
+uint64_t utils::hash_seed(uint64_t a, uint64_t b, uint64_t c) {
+    // splitmix64 finalizer over a running combination
+    auto mix = [](uint64_t z) {
+        z += 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    };
+    return mix(mix(mix(a) ^ b) ^ c);
 }
 
-double utils::clamp(double lo, double hi, double val) {
+Real utils::clamp(Real lo, Real hi, Real val) {
     if (val < lo) {
         return lo;
     } else if (val > hi) {
@@ -24,7 +79,7 @@ double utils::clamp(double lo, double hi, double val) {
     }
 }
 
-double utils::deg_to_rad(double degrees) {
+Real utils::deg_to_rad(Real degrees) {
     return degrees * M_PI / 180;
 }
 
@@ -42,8 +97,8 @@ Image utils::load_texture(const std::string& fpath) {
     return img;
 }
 
-double utils::mitchell_filter(double x) {
-    const double B = 1.0/3.0, C = 1.0/3.0;
+Real utils::mitchell_filter(Real x) {
+    const Real B = 1.0/3.0, C = 1.0/3.0;
     x = abs(x);
     if (x < 1.0) {
         return ((12 - 9*B - 6*C)*x*x*x + (-18 + 12*B + 6*C)*x*x + (6 - 2*B))/6.0;
@@ -51,4 +106,24 @@ double utils::mitchell_filter(double x) {
         return ((-B - 6*C)*x*x*x + (6*B + 30*C)*x*x + (-12*B - 48*C)*x + (8*B + 24*C))/6.0;
     }
     return 0.0;
+}
+
+ImageDiff utils::compare_images(const std::vector<unsigned char>& golden, const std::vector<unsigned char>& image) {
+    ImageDiff diff;
+    if (golden.size() != image.size() || golden.empty()) {
+        std::cerr << "Image comparison: size mismatch\n";
+        diff.psnr = 0;
+        return diff;
+    }
+
+    Real sq_sum = 0;
+    for (size_t i = 0; i < golden.size(); i++) {
+        int d = static_cast<int>(golden[i]) - static_cast<int>(image[i]);
+        sq_sum += d * d;
+        diff.max_abs = std::max(diff.max_abs, std::abs(d));
+    }
+
+    diff.rmse = std::sqrt(sq_sum / golden.size());
+    diff.psnr = diff.rmse > 0 ? 20 * std::log10(255.0 / diff.rmse) : std::numeric_limits<Real>::infinity();
+    return diff;
 }
\ No newline at end of file
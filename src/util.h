@@ -9,8 +9,10 @@
 #include <string>
 #include <iostream>
 #include <thread>
+#include <cstdint>
 
 #include "lib/stb_image.h"
+#include "config.h"
 
 #define EPSILON 1e-6
 
@@ -21,20 +23,37 @@ struct Image {
     int channels    = 0;
 };
 
+// Per-channel difference between two 8-bit images of equal size
+struct ImageDiff {
+    Real    rmse        = 0;
+    Real    psnr        = 0;        // In dB; infinity for identical images
+    int     max_abs     = 0;
+};
+
 namespace utils {
-    // Generates a random double in range [x, y)
-    double random_double(double x, double y);
+    // Generates a random Real in range [x, y) from the calling thread's PCG32 stream
+    Real random_double(Real x, Real y);
+
+    // Restarts the calling thread's random stream. The renderer reseeds per pixel sample so that an image does not
+    // depend on which thread (or process) rendered which tile.
+    void seed_random(uint64_t seed);
+
+    // Mixes three values into one well-distributed seed
+    uint64_t hash_seed(uint64_t a, uint64_t b, uint64_t c);
 
     // Clamps the input value within the desired range
-    double clamp(double lo, double hi, double val);
+    Real clamp(Real lo, Real hi, Real val);
 
     // Converts degree to equivalent radians
-    double deg_to_rad(double deg);
+    Real deg_to_rad(Real deg);
 
     // Loads a texture from a given image file
     Image load_texture(const std::string& fpath);
 
     // Mitchell-Netravali AA-filter
-    double mitchell_filter(double x);
+    Real mitchell_filter(Real x);
+
+    // Compares an image against a golden reference of the same size
+    ImageDiff compare_images(const std::vector<unsigned char>& golden, const std::vector<unsigned char>& image);
 }
 #endif
\ No newline at end of file
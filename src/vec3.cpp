@@ -1,30 +1,22 @@
 #include "vec3.h"
+#include "sampling/warp.h"
 #define _USE_MATH_DEFINES
 
 // Constructors
 vec3::vec3() : xyz{0, 0, 0} { }
-vec3::vec3(double x, double y, double z) : xyz{x, y, z} {}
-vec3::vec3(double r, double g, double b, double a) : xyz{r, g, b}, alpha(a) {}
+vec3::vec3(Real x, Real y, Real z) : xyz{x, y, z} {}
+vec3::vec3(Real r, Real g, Real b, Real a) : xyz{r, g, b}, alpha(a) {}
 
 // Getters / Setters
-double vec3::x() const {
-    return xyz[0];
-}
-double vec3::y() const {
-    return xyz[1];
-}
-double vec3::z() const {
-    return xyz[2];
-}
-double vec3::get_alpha() const {
+Real vec3::get_alpha() const {
     return alpha;
 }
-void vec3::set_alpha(double value) {
+void vec3::set_alpha(Real value) {
     alpha = value;
 }
 
 // Utils
-double vec3::magnitude() const {
+Real vec3::magnitude() const {
     return sqrt(pow(xyz[0], 2) + pow(xyz[1], 2) + pow(xyz[2], 2));
 }
 void vec3::print() const {
@@ -45,18 +37,12 @@ vec3 cross(vec3 &vec_1, vec3 &vec_2) {
 }
 
 vec3 vec3::unit_vector() const {
-    double length = magnitude();
+    Real length = magnitude();
     return vec3(xyz[0] / length, xyz[1] / length, xyz[2] / length);
 }
 
-vec3 random_vector(double radius) {
-    double u = utils::random_double(0, radius);
-    double theta = utils::random_double(0.0, 2 * M_PI); // azimuthal angle
-    double phi = acos(1 - 2 * utils::random_double(0.0, 1.0)); // polar angle (correct for uniformity)
-
-    double x = sin(phi) * cos(theta);
-    double y = sin(phi) * sin(theta);
-    double z = cos(phi);
-    
-    return vec3(x, y, z);
+vec3 random_vector(Real radius) {
+    Real u1 = utils::random_double(0.0, 1.0);
+    Real u2 = utils::random_double(0.0, 1.0);
+    return warp::square_to_uniform_sphere(u1, u2) * radius;
 }
\ No newline at end of file
@@ -14,23 +14,23 @@
 class vec3 {
     private:
         // Current location on a XYZ-plane. RGB for colors.
-        double xyz[3];
+        Real xyz[3];
 
         // Only for colors. -1 implies a vector coordinate.
-        double alpha = -1;
+        Real alpha = -1;
 
     public:
         // constructors
         vec3();
-        vec3(double x, double y, double z);
-        vec3(double r, double g, double b, double a);
+        vec3(Real x, Real y, Real z);
+        vec3(Real r, Real g, Real b, Real a);
 
-        // piecewise getters
-        double x() const;
-        double y() const;
-        double z() const;
-        double get_alpha() const;
-        void set_alpha(double value);
+        // piecewise getters (inline so that hot kernels can keep components in registers)
+        Real x() const { return xyz[0]; }
+        Real y() const { return xyz[1]; }
+        Real z() const { return xyz[2]; }
+        Real get_alpha() const;
+        void set_alpha(Real value);
 
         // local operators (for convenience)
         vec3 operator+=(const vec3 &vec) {
@@ -47,14 +47,14 @@ class vec3 {
 
             return *this;
         }
-        vec3 operator*=(double k) {
+        vec3 operator*=(Real k) {
             for (int i = 0; i < 3; i++) {
                 xyz[i] *= k;
             }
 
             return *this;
         }
-        vec3 operator/=(double k) {
+        vec3 operator/=(Real k) {
             for (int i = 0; i < 3; i++) {
                 xyz[i] /= k;
             }
@@ -67,7 +67,7 @@ class vec3 {
                         vec_1.xyz[1] + vec_2.xyz[1],
                         vec_1.xyz[2] + vec_2.xyz[2]);
         }
-        inline friend vec3 operator+(const vec3 &vec_1, double k) {
+        inline friend vec3 operator+(const vec3 &vec_1, Real k) {
             return vec3(vec_1.xyz[0] + k,
                         vec_1.xyz[1] + k,
                         vec_1.xyz[2] + k);
@@ -77,25 +77,25 @@ class vec3 {
                         vec_1.xyz[1] - vec_2.xyz[1],
                         vec_1.xyz[2] - vec_2.xyz[2]);
         }
-        inline friend vec3 operator-(const vec3 &vec_1, double k) {
+        inline friend vec3 operator-(const vec3 &vec_1, Real k) {
             return vec3(vec_1.xyz[0] - k,
                         vec_1.xyz[1] - k,
                         vec_1.xyz[2] - k);
         }
-        inline vec3 friend operator*(const vec3 &vec_1, double k) {
+        inline vec3 friend operator*(const vec3 &vec_1, Real k) {
             return vec3(vec_1.xyz[0] * k,
                         vec_1.xyz[1] * k,
                         vec_1.xyz[2] * k);
         }
-        inline vec3 friend operator*(double k, const vec3 &vec_1) {
+        inline vec3 friend operator*(Real k, const vec3 &vec_1) {
             return vec_1 * k;
         }
 
         // Equivalent to dot product
-        inline double friend operator*(const vec3 &vec_1, const vec3 &vec_2) {
+        inline Real friend operator*(const vec3 &vec_1, const vec3 &vec_2) {
             return (vec_1.xyz[0] * vec_2.xyz[0] + vec_1.xyz[1] * vec_2.xyz[1] + vec_1.xyz[2] * vec_2.xyz[2]);
         }
-        inline friend vec3 operator/(const vec3 &vec_1, double k) {
+        inline friend vec3 operator/(const vec3 &vec_1, Real k) {
             return vec3(vec_1.xyz[0] / k,
                         vec_1.xyz[1] / k,
                         vec_1.xyz[2] / k);
@@ -103,7 +103,7 @@ class vec3 {
 
         // Utils
         // Returns the Euclidean magnitude of the vector
-        double magnitude() const;
+        Real magnitude() const;
 
         // Prints the current coordinate of the vector
         void print() const;
@@ -112,12 +112,22 @@ class vec3 {
         vec3 unit_vector() const;
 };
 
-// Returns a random vector in the spcecified sphere space
-vec3 random_vector(double radius);
+// Returns a uniformly distributed random vector on the surface of the sphere with the specified radius
+vec3 random_vector(Real radius);
 
 
 // Returns the cross product of the two vectors
 vec3 cross(vec3 &vec_1, vec3 &vec_2);
 
+// Returns the componentwise product of the two vectors (e.g. color attenuation)
+inline vec3 hadamard(const vec3 &vec_1, const vec3 &vec_2) {
+    return vec3(vec_1.x() * vec_2.x(), vec_1.y() * vec_2.y(), vec_1.z() * vec_2.z());
+}
+
+// Returns the largest of the three components
+inline Real max_component(const vec3 &vec) {
+    return std::fmax(vec.x(), std::fmax(vec.y(), vec.z()));
+}
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*
+    Checks the AABB slab test for rays lying in a slab plane: an origin on either the lo or the hi plane of an
+    axis, with a +0 or -0 direction component along it, must hit the box, and a parallel ray just outside
+    must miss. Both the single and the batched test are checked.
+
+    g++ -O2 -I src -o aabb_test tests/aabb_test.cpp src/vec3.cpp src/ray.cpp src/util.cpp src/objects/bvh/aabb.cpp
+    ./aabb_test
+*/
+
+#include <cstdio>
+#include <cmath>
+#include "objects/bvh/aabb.h"
+
+// util.cpp (random numbers for vec3.cpp) loads textures through stb_image, which main.cpp otherwise provides
+#define STB_IMAGE_IMPLEMENTATION
+#include "lib/stb_image.h"
+
+int main() {
+    const AABB box(vec3(0, 0, 0), vec3(1, 1, 1));
+    // The box pads its bounds, so the planes are where get_lo and get_hi put them
+    const vec3 lo = box.get_lo();
+    const vec3 hi = box.get_hi();
+
+    int failures = 0;
+    auto check = [&](const char* name, const ray& r, bool expected) {
+        bool single = box.ray_hit(r, 1e-4, 1e9);
+        bool batched = false;
+        AABB::ray_hit_n(&box, 1, r, 1e-4, 1e9, &batched);
+        bool ok = single == expected && batched == expected;
+        std::printf("%s: %s (expected %s)\n", ok ? "ok" : "FAIL", name, expected ? "hit" : "miss");
+        failures += !ok;
+    };
+
+    const Real lo_plane[3] = {lo.x(), lo.y(), lo.z()};
+    const Real hi_plane[3] = {hi.x(), hi.y(), hi.z()};
+    for (int axis = 0; axis < 3; axis++) {
+        // The ray runs along the next axis from in front of the box, flat in a plane of this one
+        const int along = (axis + 1) % 3;
+        for (Real zero : {Real(0), -Real(0)}) {
+            Real d[3] = {0, 0, 0};
+            d[along] = 1;
+            d[axis] = zero;
+            for (int plane = 0; plane < 2; plane++) {
+                Real o[3] = {0.5, 0.5, 0.5};
+                o[along] = -1;
+                o[axis] = plane == 0 ? lo_plane[axis] : hi_plane[axis];
+
+                char name[96];
+                std::snprintf(name, sizeof(name), "axis %d, on the %s plane, %c0 direction", axis, plane == 0 ? "lo" : "hi",
+                              std::signbit(zero) ? '-' : '+');
+                check(name, ray(vec3(o[0], o[1], o[2]), vec3(d[0], d[1], d[2])), true);
+
+                o[axis] += plane == 0 ? -1e-3 : 1e-3;
+                std::snprintf(name, sizeof(name), "axis %d, outside the %s plane, %c0 direction", axis, plane == 0 ? "lo" : "hi",
+                              std::signbit(zero) ? '-' : '+');
+                check(name, ray(vec3(o[0], o[1], o[2]), vec3(d[0], d[1], d[2])), false);
+            }
+        }
+    }
+    return failures != 0;
+}
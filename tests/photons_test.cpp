@@ -0,0 +1,104 @@
+/*
+    Checks the caustic photon map's hashed grid: every photon must sit in the slot its cell hashes to, and
+    estimate() must agree with a gather over all photons at query points on and around the caustic.
+
+    g++ -O2 -pthread -I src -o photons_test tests/photons_test.cpp src/vec3.cpp src/color.cpp src/ray.cpp src/util.cpp src/fastmath.cpp src/sampling/warp.cpp src/render/thread_pool.cpp src/render/topology.cpp src/render/photons.cpp src/objects/objs.cpp src/objects/sphere.cpp src/objects/quad.cpp src/objects/world.cpp src/material/material.cpp src/material/diffuse.cpp src/material/metal.cpp src/material/dielectric.cpp src/material/bulb.cpp src/texture/texture.cpp src/objects/bvh/aabb.cpp src/objects/bvh/bvh.cpp
+    ./photons_test
+*/
+
+#include <cstdio>
+#include <cmath>
+#include "render/photons.h"
+#include "objects/world.h"
+#include "objects/sphere.h"
+#include "objects/quad.h"
+#include "objects/bvh/bvh.h"
+#include "material/diffuse.h"
+#include "material/dielectric.h"
+#include "material/bulb.h"
+
+// util.cpp loads textures through stb_image, which main.cpp otherwise provides
+#define STB_IMAGE_IMPLEMENTATION
+#include "lib/stb_image.h"
+
+struct photon_map_test {
+    // Photons stored outside the slot their position hashes to
+    static size_t misplaced(const photon_map& map) {
+        size_t count = 0;
+        for (uint32_t s = 0; s + 1 < map.slot_start.size(); s++) {
+            for (uint32_t i = map.slot_start[s]; i < map.slot_start[s + 1]; i++) {
+                const auto& ph = map.photons[i];
+                count += map.slot_of(map.cell_of(ph.x), map.cell_of(ph.y), map.cell_of(ph.z)) != s;
+            }
+        }
+        return count;
+    }
+
+    // estimate() without the grid
+    static color brute_force(const photon_map& map, const hit_history& hist) {
+        const material* mat = hist.material_.get();
+        const vec3& p = hist.intersection;
+        const vec3& n = hist.normal;
+        const Real r = map.settings.radius;
+        color sum(0, 0, 0);
+        for (const auto& ph : map.photons) {
+            vec3 offset(ph.x - p.x(), ph.y - p.y(), ph.z - p.z());
+            Real d2 = offset * offset;
+            vec3 from(ph.wx, ph.wy, ph.wz);
+            Real cos_theta = from * n;
+            if (d2 >= r * r || cos_theta <= 0 || std::fabs(offset * n) > r / 4) {
+                continue;
+            }
+            color f = mat->eval(from, n, hist.u, hist.v, hist.intersection) / cos_theta;
+            sum += hadamard(f, color(ph.r, ph.g, ph.b)) * (1 - std::sqrt(d2) / r);
+        }
+        return sum / ((1 - Real(2) / 3) * M_PI * r * r);
+    }
+};
+
+int main() {
+    // A small bulb above a glass ball focuses a caustic onto the floor
+    auto floor_material = make_shared<diffuse>(vec3(.8, .8, .8));
+    world scene_list;
+    scene_list.insert(make_shared<Quad>(vec3(-5, -1, -1), vec3(10, 0, 0), vec3(0, 0, -10), floor_material));
+    scene_list.insert(make_shared<sphere>(1, vec3(1.2, 0, -6), make_shared<dielectric>(1.5)));
+    scene_list.insert(make_shared<sphere>(0.1, vec3(1.2, 2.5, -6), make_shared<Bulb>(vec3(400, 400, 400))));
+    world scene(make_shared<BoundingVolumeNode>(scene_list));
+
+    thread_pool pool;
+    int failures = 0;
+    const photon_settings cases[] = {{200000, 0.1, 8}, {2000000, 0.05, 8}};
+    for (const photon_settings& settings : cases) {
+        photon_map map;
+        map.build(scene, settings, pool, 7);
+        size_t wrong_slot = photon_map_test::misplaced(map);
+
+        // Query a grid of floor points across the caustic and the dim floor around it; its spacing puts some of
+        // the gather spheres exactly on cell boundaries
+        int mismatches = 0;
+        Real total = 0, total_reference = 0;
+        for (int j = 0; j < 40; j++) {
+            for (int i = 0; i < 40; i++) {
+                hit_history hist;
+                hist.intersection = vec3(1.2 + (i - 19.5) * 0.04, -1, -6 + (j - 19.5) * 0.04);
+                hist.normal = vec3(0, 1, 0);
+                hist.is_front = true;
+                hist.u = hist.v = 0;
+                hist.material_ = floor_material;
+                color grid = map.estimate(hist);
+                color reference = photon_map_test::brute_force(map, hist);
+                total += grid.x();
+                total_reference += reference.x();
+                if (std::fabs(grid.x() - reference.x()) > 1e-4 * std::fmax(Real(1), reference.x())) {
+                    mismatches++;
+                }
+            }
+        }
+
+        bool ok = map.size() > 0 && wrong_slot == 0 && mismatches == 0;
+        std::printf("%s: %d photons, radius %g: %zu stored, %zu in the wrong slot, %d of 1600 estimates differ (sum %g vs %g)\n",
+                    ok ? "ok" : "FAIL", settings.photons, settings.radius, map.size(), wrong_slot, mismatches, total, total_reference);
+        failures += !ok;
+    }
+    return failures != 0;
+}
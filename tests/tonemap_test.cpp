@@ -0,0 +1,57 @@
+/*
+    Checks tone mapping of values the film can hold after an overflow or a bad sample: +inf must develop to white
+    and NaN, -inf and negative values to black under every operator, without indexing outside the sRGB table.
+    Build with -fsanitize=address to catch out-of-range lookups.
+
+    g++ -O2 -I src -o tonemap_test tests/tonemap_test.cpp src/render/tonemap.cpp
+    ./tonemap_test
+*/
+
+#include <cstdio>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "render/tonemap.h"
+
+int main() {
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    struct input {
+        const char*     name;
+        float           value;
+        unsigned char   expected;
+    };
+    const input inputs[] = {
+        {"+inf", inf, 255}, {"-inf", -inf, 0}, {"NaN", nan, 0}, {"-NaN", -nan, 0},
+        {"1e30", 1e30f, 255}, {"max float", std::numeric_limits<float>::max(), 255}, {"-1", -1.0f, 0}, {"-0", -0.0f, 0},
+    };
+    const tone_operator ops[] = {tone_operator::clamp, tone_operator::reinhard, tone_operator::aces};
+
+    int failures = 0;
+    for (tone_operator op : ops) {
+        for (float exposure : {1.0f, 1e30f}) {
+            for (const input& in : inputs) {
+                // Enough pixels to fill a whole block and a tail, each channel holding the value in turn
+                const int count = 70;
+                std::vector<float> rgba(count * 4, 0.5f);
+                for (int p = 0; p < count; p++) {
+                    rgba[p * 4 + p % 3] = in.value;
+                }
+                std::vector<unsigned char> rgb(count * 3);
+                tonemap::apply(rgba.data(), rgb.data(), count, op, exposure);
+
+                // Huge exposures push the 0.5 channels to white as well; the value's own channel is what is checked
+                bool ok = true;
+                for (int p = 0; p < count; p++) {
+                    ok = ok && rgb[p * 3 + p % 3] == in.expected;
+                }
+                if (!ok) {
+                    std::printf("FAIL: %s, exposure %g, %s: expected %d\n", tone_operator_name(op), exposure, in.name, in.expected);
+                    failures++;
+                }
+            }
+        }
+    }
+    std::printf("%s: %d cases failed\n", failures == 0 ? "ok" : "FAIL", failures);
+    return failures != 0;
+}